@@ -66,7 +66,7 @@ void R_MTU3_Create(void)
     MTU5.TSTR.BYTE = _00_MTU_CSTW5_OFF | _00_MTU_CSTV5_OFF | _00_MTU_CSTU5_OFF;
 
     /* Set interrupt priority level */
-    IPR(MTU5, TGIU5) = _0E_MTU_PRIORITY_LEVEL14;
+    IPR(MTU5, TGIU5) = _05_MTU_PRIORITY_LEVEL5;
 
     /* Channel 0 is used as PWM1 mode */
     MTU0.TCR.BYTE = _00_MTU_PCLK_1 | _00_MTU_CKEG_RISE | _A0_MTU_CKCL_C;
@@ -307,6 +307,7 @@ void R_SCI1_Start(void);
 void R_SCI1_Stop(void);
 MD_STATUS R_SCI1_Serial_Receive(uint8_t * const rx_buf, uint16_t rx_num);
 static void r_sci1_callback_receiveend(void);
+static void r_sci1_callback_receiveerror(void);
 void R_SCI5_Create(void);
 void R_SCI5_Start(void);
 void R_SCI5_Stop(void);
@@ -314,6 +315,7 @@ MD_STATUS R_SCI5_Serial_Send(uint8_t * const tx_buf, uint16_t tx_num);
 MD_STATUS R_SCI5_Serial_Receive(uint8_t * const rx_buf, uint16_t rx_num);
 static void r_sci5_callback_transmitend(void);
 static void r_sci5_callback_receiveend(void);
+static void r_sci5_callback_receiveerror(void);
 
 /* Start user code for function. Do not edit comment generated here */
 /* End user code. Do not edit comment generated here */
@@ -54,8 +54,10 @@ extern uint16_t  g_sci5_rx_count;                   /* SCI5 receive data number
 extern uint16_t  g_sci5_rx_length;                  /* SCI5 receive data length */
 /* Start user code for global. Do not edit comment generated here */
 extern void u_sci1_receiveend_callback(void);
+extern void u_sci1_receiveerror_callback(uint8_t ssr);
 extern void u_sci5_receiveend_callback(void);
 extern void u_sci5_transmitend_callback(void);
+extern void u_sci5_receiveerror_callback(uint8_t ssr);
 /* End user code. Do not edit comment generated here */
 
 
@@ -99,6 +101,8 @@ static void r_sci1_receiveerror_interrupt(void)
 {
     uint8_t err_type;
 
+    r_sci1_callback_receiveerror();
+
     /* Clear overrun, framing and parity error flags */
     err_type = SCI1.SSR.BYTE;
     err_type &= 0xC7U;
@@ -118,6 +122,18 @@ static void r_sci1_callback_receiveend(void)
     /* End user code. Do not edit comment generated here */
 }
 /***********************************************************************************************************************
+* Function Name: r_sci1_callback_receiveerror
+* Description  : This function is a callback function when SCI1 reception encounters error.
+* Arguments    : None
+* Return Value : None
+***********************************************************************************************************************/
+static void r_sci1_callback_receiveerror(void)
+{
+    /* Start user code. Do not edit comment generated here */
+    u_sci1_receiveerror_callback(SCI1.SSR.BYTE);
+    /* End user code. Do not edit comment generated here */
+}
+/***********************************************************************************************************************
 * Function Name: r_sci5_transmit_interrupt
 * Description  : None
 * Arguments    : None
@@ -204,6 +220,8 @@ static void r_sci5_receiveerror_interrupt(void)
 {
     uint8_t err_type;
 
+    r_sci5_callback_receiveerror();
+
     /* Clear overrun, framing and parity error flags */
     err_type = SCI5.SSR.BYTE;
     err_type &= 0xC7U;
@@ -234,6 +252,18 @@ static void r_sci5_callback_receiveend(void)
     u_sci5_receiveend_callback();
     /* End user code. Do not edit comment generated here */
 }
+/***********************************************************************************************************************
+* Function Name: r_sci5_callback_receiveerror
+* Description  : This function is a callback function when SCI5 reception encounters error.
+* Arguments    : None
+* Return Value : None
+***********************************************************************************************************************/
+static void r_sci5_callback_receiveerror(void)
+{
+    /* Start user code. Do not edit comment generated here */
+    u_sci5_receiveerror_callback(SCI5.SSR.BYTE);
+    /* End user code. Do not edit comment generated here */
+}
 
 /* Start user code for adding. Do not edit comment generated here */
 /* End user code. Do not edit comment generated here */
@@ -6,8 +6,10 @@
  */
 
 /* RTOS & rx23t include files. */
+#include <math.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "platform.h"
 
 /*-----------------------------------------------------------*/
@@ -15,61 +17,224 @@
 #include "alt_control.h"
 #include "sonar.h"
 #include "ppm_encoder.h"
+#include "pid_control.h"
+#include "trajectory.h"
+#include "height_est.h"
 
-static TaskHandle_t alt_ctl_taskhandle;
-static float des_height;
-static int out_of_range_times = 0;
-static bool recorrect_height = false;
+static TaskHandle_t alt_ctl_taskhandle = NULL;
+static struct trajectory alt_traj;
+/* alt_waiting is set while a task waits in alt_ctl_move_to(),
+ * the end of the move gives alt_done. */
+static volatile bool alt_waiting = false;
+static SemaphoreHandle_t alt_done = NULL;
+static struct pid2 alt_height_pid;
+static struct pid2 alt_rate_pid;
+static struct pid2_param alt_height_pp;
+static struct pid2_param alt_rate_pp;
+/* dt the PIDs were last configured for, 0 before the first. */
+static float alt_cfg_dt;
+/* kept between flights, so the next one starts from it. */
+static float hover_throttle = ALT_HOVER_INIT;
 
 
 static void alt_ctl_task_entry(void *pvParameters);
+static void alt_pid_init(void);
+static void alt_pid_configure(float dt);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
+/* ----------------------------------------------------------
+ *
+ * starts holding the height, a destination away from the
+ * current height is reached along the profile.
+ *
+ * --------------------------------------------------------*/
 void alt_ctl_start(float dest_height)
 {
     BaseType_t ret;
-    des_height = dest_height;
+    if (alt_done == NULL) {
+        alt_done = xSemaphoreCreateBinary();
+        configASSERT(alt_done != NULL);
+    }
+    trajectory_init(&alt_traj, current_Height, ALT_TRAJ_V_MAX, ALT_TRAJ_A_MAX);
+    trajectory_set_target(&alt_traj, dest_height);
+    alt_pid_init();
+    pid2_reset(&alt_height_pid);
+    pid2_reset(&alt_rate_pid);
+    ppm_channel_claim(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL));
     ret = xTaskCreate(alt_ctl_task_entry,
                       "alt_ctl",
-                      configMINIMAL_STACK_SIZE,
+                      configMINIMAL_STACK_SIZE * 2,
                       NULL,
                       ALT_CTL_TASK_PRI,
                       &alt_ctl_taskhandle);
     configASSERT(ret == pdPASS);
 }
 
+/* ----------------------------------------------------------
+ *
+ * moves to a new destination height and blocks until the
+ * profile has ended & the height is within ALT_DONE_BAND, or
+ * timeout. the height is held afterwards either way.
+ * NOTE:alt_ctl_start() first. one waiting task at a time.
+ *
+ * --------------------------------------------------------*/
+bool alt_ctl_move_to(float dest_height, TickType_t timeout)
+{
+    BaseType_t done;
+
+    /* drop a done left over from an earlier, timed out move. */
+    xSemaphoreTake(alt_done, 0);
+    taskENTER_CRITICAL();
+    trajectory_set_target(&alt_traj, dest_height);
+    alt_waiting = true;
+    taskEXIT_CRITICAL();
+
+    done = xSemaphoreTake(alt_done, timeout);
+    taskENTER_CRITICAL();
+    alt_waiting = false;
+    taskEXIT_CRITICAL();
+
+    return done == pdTRUE;
+}
+
+/* does nothing if the altitude control is not running. */
 void alt_ctl_stop(void)
 {
+    if (alt_ctl_taskhandle == NULL) return;
+    taskENTER_CRITICAL();
+    alt_waiting = false;
+    taskEXIT_CRITICAL();
+#if ALT_PPM_SYNC
+    ppm_frame_unsubscribe(alt_ctl_taskhandle);
+#endif
     vTaskDelete(alt_ctl_taskhandle);
+    alt_ctl_taskhandle = NULL;
+    ppm_channel_release(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL));
+}
+
+float alt_ctl_hover_throttle(void)
+{
+    return hover_throttle;
 }
 
 /*-----------------------------------------------------------*/
 /* private functions definition. */
 static void alt_ctl_task_entry(void *pvParameters)
 {
+#if !ALT_PPM_SYNC
     TickType_t xLastWakeTime;
+#endif
+    struct sonar_sample s;
+    struct height_estimate est;
+    uint32_t last_id, last_us;
+    float height, last_height;
+    float rate = 0.0f, rate_dest, throttle, dt, shift;
+    float h_ref, v_ref, dest;
+    bool done, release;
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+    sonar_read(&s);
+    last_id = s.id;
+    last_us = s.t_us;
+    last_height = current_Height;
+#if ALT_PPM_SYNC
+    ppm_frame_subscribe(xTaskGetCurrentTaskHandle());
+#else
     xLastWakeTime = xTaskGetTickCount();
+#endif
 
     while (1) {
-        if (recorrect_height) {
-            if (current_Height < des_height - ALT_CTL_DEADZONE) {
-                send_ppm(0,0,channel_percent(61),0,Alt_Hold,0);
-            } else if (current_Height > des_height + ALT_CTL_DEADZONE) {
-                send_ppm(0,0,channel_percent(39),0,Alt_Hold,0);
-            } else {
-                send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
-                out_of_range_times = 0;
-                recorrect_height = false;
-            }
-        } else if (current_Height < des_height - ALT_CTL_DEADZONE || current_Height > des_height + ALT_CTL_DEADZONE) {
-            out_of_range_times++;
-            if (out_of_range_times > 10) {
-                recorrect_height = true;
-            }
+#if ALT_PPM_SYNC
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000/ALT_CTL_FREQ));
+#else
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(1000/ALT_CTL_FREQ));
+#endif
+        /* one update per valid sample, timed by the sonar. samples
+         * that came in the same wait are covered by one dt. */
+        sonar_read(&s);
+        if (s.id == last_id) continue;
+        last_id = s.id;
+        if (!s.valid) continue;
+
+        dt = (float)(s.t_us - last_us) * 1e-6f;
+        last_us = s.t_us;
+        if (dt < ALT_DT_MIN) dt = ALT_DT_MIN;
+        if (dt > ALT_DT_MAX) dt = ALT_DT_MAX;
+        alt_pid_configure(dt);
+
+        /* the estimator is woken by the sample first, its h & v are
+         * used once it has taken the sample in. */
+        height_est_read(&est);
+        if (est.valid && est.sample_id == s.id) {
+            height = est.h;
+            rate = est.v;
+        } else {
+            height = s.height;
+            rate += dt / (ALT_RATE_LPF + dt) * ((height - last_height) / dt - rate);
         }
+        last_height = height;
 
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(1000/ALT_CTL_FREQ));
+        taskENTER_CRITICAL();
+        trajectory_step(&alt_traj, dt);
+        h_ref = alt_traj.pos;
+        v_ref = alt_traj.vel;
+        dest  = alt_traj.target;
+        done  = alt_traj.done;
+        taskEXIT_CRITICAL();
+
+        rate_dest = pid2_update(&alt_height_pid, h_ref, height, v_ref);
+        throttle = pid2_update(&alt_rate_pid, rate_dest, rate, 0.0f);
+
+        /* the end of the profile & the height in band releases the waiting task. */
+        if (done && height > dest - ALT_DONE_BAND && height < dest + ALT_DONE_BAND) {
+            taskENTER_CRITICAL();
+            release = alt_waiting;
+            alt_waiting = false;
+            taskEXIT_CRITICAL();
+            if (release)
+                xSemaphoreGive(alt_done);
+        }
+
+        /* near the destination the integrator is the hover error. */
+        if (done && height > dest - ALT_HOVER_BAND && height < dest + ALT_HOVER_BAND) {
+            shift = alt_rate_pid.integrator * ALT_HOVER_LEARN * dt;
+            if (hover_throttle + shift > ALT_HOVER_MAX) shift = ALT_HOVER_MAX - hover_throttle;
+            if (hover_throttle + shift < ALT_HOVER_MIN) shift = ALT_HOVER_MIN - hover_throttle;
+            hover_throttle += shift;
+            alt_rate_pid.integrator -= shift;
+        }
+
+        ch[THROTTLE_CHANNEL] = (uint16_t)(hover_throttle + throttle);
+        ppm_channel_update(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL), ch);
     }
 }
 
+static void alt_pid_init(void)
+{
+    pid2_param_init(&alt_height_pp);
+    alt_height_pp.kp      = ALT_H_KP;
+    alt_height_pp.ki      = ALT_H_KI;
+    alt_height_pp.kd      = 0.0f;
+    alt_height_pp.i_max   = ALT_RATE_MAX;
+    alt_height_pp.out_max = ALT_RATE_MAX;
+
+    pid2_param_init(&alt_rate_pp);
+    alt_rate_pp.kp      = ALT_RATE_KP;
+    alt_rate_pp.ki      = ALT_RATE_KI;
+    alt_rate_pp.kd      = ALT_RATE_KD;
+    alt_rate_pp.i_max   = ALT_RATE_I_MAX;
+    alt_rate_pp.out_max = ALT_THR_MAX;
+    alt_cfg_dt = 0.0f;
+}
+
+/* the gains are fixed, only a dt ALT_DT_TOL away from the last
+ * one configures the PIDs again. */
+static void alt_pid_configure(float dt)
+{
+    if (fabsf(dt - alt_cfg_dt) <= ALT_DT_TOL) return;
+    alt_cfg_dt = dt;
+    alt_height_pp.dt = dt;
+    alt_rate_pp.dt   = dt;
+    pid2_configure(&alt_height_pid, &alt_height_pp);
+    pid2_configure(&alt_rate_pid, &alt_rate_pp);
+}
@@ -8,12 +8,49 @@
 #ifndef COMPONENTS_ALT_CONTROL_H_
 #define COMPONENTS_ALT_CONTROL_H_
 
+#include <stdbool.h>
+
 #define ALT_CTL_TASK_PRI    5
 
-#define ALT_CTL_DEADZONE    0.05   /* units:m */
-#define ALT_CTL_FREQ        10
+#define ALT_CTL_FREQ        25      /* polls for new sonar samples, one update per valid sample. */
+#define ALT_PPM_SYNC        1       /* polls just before each PPM latch instead, ALT_CTL_FREQ is the fallback. */
+#define ALT_DT_MIN          0.01f   /* bounds of the measured dt, units: s */
+#define ALT_DT_MAX          0.2f
+#define ALT_DT_TOL          0.002f  /* dt changes the PIDs are configured again for, units: s */
+
+/* ----------------------------------------------------------
+ *
+ * cascade: the height loop commands a climb rate, the rate
+ * loop commands the throttle around the hover throttle. the
+ * hover throttle is learned by moving the rate integrator
+ * into it while the height is near the destination.
+ *
+ * --------------------------------------------------------*/
+#define ALT_H_KP            1.2f    /* height error(m) to climb rate(m/s). */
+#define ALT_H_KI            0.0f
+#define ALT_RATE_MAX        0.5f    /* units: m/s */
+#define ALT_RATE_KP         120.0f  /* climb rate error(m/s) to throttle(ppm us). */
+#define ALT_RATE_KI         60.0f
+#define ALT_RATE_KD         0.0f
+#define ALT_RATE_I_MAX      80.0f
+#define ALT_THR_MAX         150.0f  /* throttle around the hover throttle, units: ppm us */
+#define ALT_RATE_LPF        0.1f    /* climb rate low pass time constant, units: s */
+
+#define ALT_HOVER_INIT      channel_percent(50)
+#define ALT_HOVER_MIN       channel_percent(40)
+#define ALT_HOVER_MAX       channel_percent(60)
+#define ALT_HOVER_LEARN     0.5f    /* units: 1/s */
+#define ALT_HOVER_BAND      0.1f    /* learns only within this of the destination, units: m */
+
+/* the destination height is reached along a trapezoidal profile,
+ * whose velocity is fed forward to the rate loop. */
+#define ALT_TRAJ_V_MAX      0.3f    /* units: m/s */
+#define ALT_TRAJ_A_MAX      0.3f    /* units: m/s^2 */
+#define ALT_DONE_BAND       0.05f   /* the move is done when the height is within this, units: m */
 
 extern void alt_ctl_start(const float dest_height);
+extern bool alt_ctl_move_to(float dest_height, TickType_t timeout);
 extern void alt_ctl_stop(void);
+extern float alt_ctl_hover_throttle(void);
 
 #endif /* COMPONENTS_ALT_CONTROL_H_ */
@@ -8,6 +8,7 @@
 /* RTOS & rx23t include files. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "platform.h"
 #include "r_cg_sci.h"
 #include "r_cg_port.h"
@@ -16,32 +17,57 @@
 /* User include files. */
 #include "cam_commu.h"
 #include "mission.h"
+#include "byte_ring.h"
+#include "serial_stats.h"
+#include "serial_capture.h"
+#include "timestamp.h"
 
 /*-----------------------------------------------------------*/
 /* private variables, */
-static uint8_t cam_rx_buffer[2][CAM_BUFFER_LENGTH];
-static int cam_rx_buffer_pointer = 0;
-static int cam_rx_pointer = 0;
-static volatile bool start_receive = pdFALSE;
+/* SCI1 receives one byte at a time into cam_rx_byte, the receive end
+ * callback moves it into the ring & re-arms the receive at once. */
+static uint8_t cam_rx_byte;
+static uint8_t cam_rx_ring_buf[CAM_RX_RING_SIZE];
+static struct byte_ring cam_rx_ring;
+static struct cam_track cam_rx_track;  /* used by interrupt only. */
+static struct cam_parser cam_parser;
+static uint16_t cam_frame_id = 0;
+/* target table, indexed by class. writers change cam_targets
+ * & publish it as a double buffered snapshot: the slot readers
+ * are not using is filled, then the sequence is bumped, whose
+ * low bit selects the slot to read. */
+static struct cam_target cam_targets[CAM_CLASS_NUM];
+static volatile struct cam_target cam_target_buf[2][CAM_CLASS_NUM];
+static volatile uint32_t cam_target_seq = 0;
 static volatile bool try_to_find_new = pdFALSE;
+/* camera mode switch, cam_mode_waiting is set while a task waits
+ * for the first frame taken in cam_mode_wanted, which gives
+ * cam_mode_ack. */
+static volatile bool cam_mode_waiting = false;
+static SemaphoreHandle_t cam_mode_ack = NULL;
+static volatile uint8_t cam_mode_wanted = CAM_MODE_UNKNOWN;
+static volatile uint32_t cam_mode_switch_us = 0;
+static volatile uint32_t cam_mode_latency_us = 0;
+/* task released on every accepted frame. */
+static volatile TaskHandle_t cam_frame_subscriber = NULL;
 
 //volatile int mission_dz_count = 0;
 
 static TaskHandle_t cam_commu_taskhandle;
 
-/*-----------------------------------------------------------*/
-/* global variables. */
-volatile uint8_t mid_x = CAMERA_MID_X, mid_y = CAMERA_MID_Y;
-
 /*-----------------------------------------------------------*/
 /* private functions declaration. */
 static void cam_commu_task_entry(void *pvParameters);
+static void cam_frame_received(const struct cam_frame *f);
+static void cam_target_publish(void);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
 void cam_commu_init()
 {
     BaseType_t ret;
+    cam_mode_ack = xSemaphoreCreateBinary();
+    configASSERT(cam_mode_ack != NULL);
     ret = xTaskCreate(cam_commu_task_entry,
                       "cam_commu",
                       configMINIMAL_STACK_SIZE,
@@ -50,8 +76,14 @@ void cam_commu_init()
                       &cam_commu_taskhandle);
     configASSERT(ret == pdPASS);
 
-    cam_rx_buffer_pointer = 0;
-    R_SCI1_Serial_Receive(cam_rx_buffer[0], CAM_BUFFER_LENGTH);
+    for (int i = 0; i < CAM_CLASS_NUM; i++) {
+        cam_targets[i].x = CAMERA_MID_X;
+        cam_targets[i].y = CAMERA_MID_Y;
+        cam_targets[i].valid = false;
+    }
+    cam_target_publish();
+    byte_ring_init(&cam_rx_ring, cam_rx_ring_buf, CAM_RX_RING_SIZE);
+    R_SCI1_Serial_Receive(&cam_rx_byte, 1);
     R_SCI1_Start();
 }
 
@@ -60,55 +92,252 @@ void try_to_find(void)
     try_to_find_new = pdTRUE;
 }
 
+/* ----------------------------------------------------------
+ *
+ * copies a consistent sample of target class cls into t
+ * without locking, and returns its age in ticks. retries only
+ * if the camera task published while the copy was made.
+ *
+ * --------------------------------------------------------*/
+TickType_t cam_target_read(cam_class_e cls, struct cam_target *t)
+{
+    volatile struct cam_target *src;
+    uint32_t seq;
+
+    do {
+        seq = cam_target_seq;
+        src = &cam_target_buf[seq & 1][cls];
+        t->x          = src->x;
+        t->y          = src->y;
+        t->valid      = src->valid;
+        t->confidence = src->confidence;
+        t->area       = src->area;
+        t->frame_id   = src->frame_id;
+        t->rx_tick    = src->rx_tick;
+        t->rx_us      = src->rx_us;
+    } while (seq != cam_target_seq);
+
+    return xTaskGetTickCount() - t->rx_tick;
+}
+
+/* ----------------------------------------------------------
+ *
+ * reads the target, returns true only if the sample is valid
+ * and not older than max_age ticks.
+ *
+ * --------------------------------------------------------*/
+bool cam_target_get(cam_class_e cls, struct cam_target *t, TickType_t max_age)
+{
+    cam_target_read(cls, t);
+    return cam_target_fresh(t, xTaskGetTickCount(), max_age);
+}
+
+/* ----------------------------------------------------------
+ *
+ * marks the current target invalid, e.g. after the camera
+ * mode is changed and the last frame belongs to the old mode.
+ *
+ * --------------------------------------------------------*/
+void cam_target_invalidate(cam_class_e cls)
+{
+    taskENTER_CRITICAL();
+    cam_targets[cls].valid = false;
+    cam_target_publish();
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * switches the camera mode and blocks until the first frame
+ * taken in the new mode arrives, or timeout. the target of
+ * the new mode is invalidated, so nothing from before the
+ * switch is used. a camera that does not tag frames with the
+ * mode always takes the whole timeout, like the old fixed
+ * delay, and returns false.
+ * NOTE:one waiting task at a time.
+ *
+ * --------------------------------------------------------*/
+bool cam_set_mode_and_wait(uint8_t mode, TickType_t timeout)
+{
+    cam_class_e cls = cam_mode_class(mode);
+    BaseType_t acked;
+
+    /* drop an acknowledge left over from an earlier, timed out switch. */
+    xSemaphoreTake(cam_mode_ack, 0);
+    taskENTER_CRITICAL();
+    cam_mode_wanted = mode;
+    cam_mode_switch_us = timestamp_us();
+    cam_mode_waiting = true;
+    taskEXIT_CRITICAL();
+
+    cam_target_invalidate(cls);
+    U_PORT_Camera_mode_select(mode);
+
+    acked = xSemaphoreTake(cam_mode_ack, timeout);
+    taskENTER_CRITICAL();
+    cam_mode_waiting = false;
+    taskEXIT_CRITICAL();
+
+    if (acked == pdTRUE) return true;
+    /* untagged frames received during the switch may be of either mode. */
+    cam_target_invalidate(cls);
+    return false;
+}
+
+/* ----------------------------------------------------------
+ *
+ * the task gets a xTaskNotifyGive() after every accepted frame
+ * has been published. there is one subscriber, NULL removes it.
+ * NOTE:remove a task before deleting it.
+ *
+ * --------------------------------------------------------*/
+void cam_frame_subscribe(TaskHandle_t task)
+{
+    taskENTER_CRITICAL();
+    cam_frame_subscriber = task;
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * microseconds from the last cam_set_mode_and_wait() call
+ * to the reception of the first frame of the new mode.
+ *
+ * --------------------------------------------------------*/
+uint32_t cam_mode_switch_latency_us(void)
+{
+    return cam_mode_latency_us;
+}
+
+/* ----------------------------------------------------------
+ *
+ * called by SCI1 receive interrupt for every byte. the byte
+ * is queued into the ring, and the parser task is only woken
+ * when cam_track_byte() sees the end of a frame. a frame it
+ * ends late, for an STX in the payload, is found by the task's
+ * CAM_RX_FRAME_TIMEOUT.
+ *
+ * --------------------------------------------------------*/
 void u_sci1_receiveend_callback(void)
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    vTaskNotifyGiveFromISR(cam_commu_taskhandle, &xHigherPriorityTaskWoken);
-    if (cam_rx_buffer_pointer == 1)
-        R_SCI1_Serial_Receive(cam_rx_buffer[0], CAM_BUFFER_LENGTH);
-    else
-        R_SCI1_Serial_Receive(cam_rx_buffer[1], CAM_BUFFER_LENGTH);
+    uint8_t byte = cam_rx_byte;
+
+    R_SCI1_Serial_Receive(&cam_rx_byte, 1);
+    byte_ring_put(&cam_rx_ring, byte);
+    serial_stats_rx_byte(SERIAL_PORT_CAM);
+    serial_capture_byte(SERIAL_PORT_CAM, byte);
+
+    if (cam_track_byte(&cam_rx_track, byte)) {
+        serial_stats_frame_end(SERIAL_PORT_CAM);
+        vTaskNotifyGiveFromISR(cam_commu_taskhandle, &xHigherPriorityTaskWoken);
+    }
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
+void u_sci1_receiveerror_callback(uint8_t ssr)
+{
+    serial_stats_rx_error(SERIAL_PORT_CAM, ssr);
+}
+
 /*-----------------------------------------------------------*/
 /* private functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * drains the receive ring in batches. the timeout makes sure
+ * bytes of a broken frame are not left in the ring forever, it
+ * is short while the parser is inside a frame, in case the
+ * interrupt lost step with it.
+ *
+ * --------------------------------------------------------*/
 static void cam_commu_task_entry(void *pvParameters)
 {
+    uint8_t batch[CAM_RX_BATCH];
+    struct cam_frame frame;
+    uint16_t n;
+
+    cam_parser_init(&cam_parser, U_PORT_Camera_mode_read());
     while (1) {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        for (int i = 0; i < CAM_BUFFER_LENGTH; i++) {
-            if (cam_rx_buffer[cam_rx_buffer_pointer][i] == COMMUNI_STX) {
-                start_receive = pdTRUE;
-                LED1 = LED_ON;
-                continue;
-            }
-            if (start_receive) {
-                cam_rx_pointer++;
-                if (cam_rx_pointer == 1) {
-                    if (cam_rx_buffer[cam_rx_buffer_pointer][i] < CAMERA_W) {
-                        mid_x = cam_rx_buffer[cam_rx_buffer_pointer][i];
-                    } else {
-                        cam_rx_pointer = 0;
-                        start_receive = pdFALSE;
-                    }
-                } else if (cam_rx_pointer == 2) {
-                    if (cam_rx_buffer[cam_rx_buffer_pointer][i] < CAMERA_H) {
-                        mid_y = cam_rx_buffer[cam_rx_buffer_pointer][i];
-//                        if (mid_x < CAMERA_MID_X + MISSION_CAM_DZ_X && mid_x > CAMERA_MID_X - MISSION_CAM_DZ_X && mid_y < CAMERA_MID_Y + MISSION_CAM_DZ_Y && mid_y > CAMERA_MID_Y - MISSION_CAM_DZ_Y) {
-//                            mission_dz_count++;
-//                        }
-                        if (try_to_find_new && U_PORT_Camera_mode_read() == CAM_MODE_GREEN) {
-                            camera_finded();
-                            try_to_find_new = pdFALSE;
-                        }
-                        LED1 = LED_OFF;
-                    }
-                    cam_rx_pointer = 0;
-                    start_receive = pdFALSE;
+        ulTaskNotifyTake(pdTRUE, (cam_parser.state == CAM_PS_IDLE) ? CAM_RX_TIMEOUT : CAM_RX_FRAME_TIMEOUT);
+        cam_parser.mode = U_PORT_Camera_mode_read();
+        while ((n = byte_ring_get(&cam_rx_ring, batch, CAM_RX_BATCH)) != 0) {
+            for (uint16_t i = 0; i < n; i++) {
+                if (batch[i] == COMMUNI_STX) LED1 = LED_ON;
+                switch (cam_parse_byte(&cam_parser, batch[i], &frame)) {
+                case CAM_PARSE_FRAME:
+                    cam_frame_received(&frame);
+                    break;
+                case CAM_PARSE_BAD:
+                case CAM_PARSE_DUP:
+                    serial_stats_frame(SERIAL_PORT_CAM, false);
+                    break;
+                default:
+                    break;
                 }
             }
         }
-        cam_rx_buffer_pointer = cam_rx_buffer_pointer ? 0 : 1;
     }
 }
+
+/* publishes a new frame, which the parser has checked. */
+static void cam_frame_received(const struct cam_frame *f)
+{
+    bool car_seen;
+    bool acked;
+    uint32_t rx_us = timestamp_us();
+
+    serial_stats_frame(SERIAL_PORT_CAM, true);
+    cam_frame_id++;
+
+    taskENTER_CRITICAL();
+    cam_table_update(cam_targets, f, cam_frame_id, xTaskGetTickCount(), rx_us);
+    car_seen = cam_targets[CAM_CLASS_CAR].valid && cam_targets[CAM_CLASS_CAR].frame_id == cam_frame_id;
+    cam_target_publish();
+    if (cam_frame_subscriber != NULL)
+        xTaskNotifyGive(cam_frame_subscriber);
+    taskEXIT_CRITICAL();
+
+    /* first frame of the requested mode releases the waiting task. */
+    taskENTER_CRITICAL();
+    acked = cam_mode_waiting && f->mode == cam_mode_wanted;
+    if (acked) {
+        cam_mode_latency_us = rx_us - cam_mode_switch_us;
+        cam_mode_waiting = false;
+    }
+    taskEXIT_CRITICAL();
+    if (acked)
+        xSemaphoreGive(cam_mode_ack);
+
+    if (try_to_find_new && car_seen) {
+        camera_finded();
+        try_to_find_new = pdFALSE;
+    }
+    LED1 = LED_OFF;
+}
+
+/* ----------------------------------------------------------
+ *
+ * copies cam_targets into the slot readers are not using.
+ * the camera task & cam_target_invalidate() both publish, so
+ * it must be called in a critical section, which serializes
+ * the writers only, readers never block.
+ *
+ * --------------------------------------------------------*/
+static void cam_target_publish(void)
+{
+    uint32_t seq = cam_target_seq + 1;
+
+    for (int i = 0; i < CAM_CLASS_NUM; i++) {
+        volatile struct cam_target *dst = &cam_target_buf[seq & 1][i];
+        dst->x          = cam_targets[i].x;
+        dst->y          = cam_targets[i].y;
+        dst->valid      = cam_targets[i].valid;
+        dst->confidence = cam_targets[i].confidence;
+        dst->area       = cam_targets[i].area;
+        dst->frame_id   = cam_targets[i].frame_id;
+        dst->rx_tick    = cam_targets[i].rx_tick;
+        dst->rx_us      = cam_targets[i].rx_us;
+    }
+    cam_target_seq = seq;
+}
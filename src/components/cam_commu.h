@@ -8,26 +8,41 @@
 #ifndef COMPONENTS_CAM_COMMU_H_
 #define COMPONENTS_CAM_COMMU_H_
 
-#define CAMERA_W            160
-#define CAMERA_H            120
-#define CAMERA_MID_X        79
-#define CAMERA_MID_Y        59
+#include <stdint.h>
+#include <stdbool.h>
+#include "cam_frame.h"
 
 //#define MISSION_CAM_DZ_X      40
 //#define MISSION_CAM_DZ_Y      30
 
-#define COMMUNI_STX         0xFE
-#define CAM_BUFFER_LENGTH   3
+/* frame format, parser & target table are in cam_frame.h. */
+#define CAM_RX_RING_SIZE    64      /* must be a power of two. */
+#define CAM_RX_BATCH        16
+#define CAM_RX_TIMEOUT      pdMS_TO_TICKS(50)
+#define CAM_RX_FRAME_TIMEOUT pdMS_TO_TICKS(20)  /* two ticks, a whole frame takes 3 ms at 115200. */
 
 #define CAM_COMMU_TASK_PRI  4
 
-#define CAM_MODE_BLACK      1
-#define CAM_MODE_GREEN      0
+#define CAM_MODE_TIMEOUT    pdMS_TO_TICKS(100)
 
-extern volatile uint8_t mid_x, mid_y;
 //extern volatile int mission_dz_count;
 
+/* ----------------------------------------------------------
+ *
+ * the latest position of each target class, struct
+ * cam_target. the camera task publishes the whole table at
+ * once, so x & y always belong to the same frame.
+ * NOTE:include FreeRTOS.h & task.h before this file for
+ * TickType_t & TaskHandle_t.
+ *
+ * --------------------------------------------------------*/
 extern void cam_commu_init(void);
 extern void try_to_find(void);
+extern TickType_t cam_target_read(cam_class_e cls, struct cam_target *t);
+extern bool cam_target_get(cam_class_e cls, struct cam_target *t, TickType_t max_age);
+extern void cam_target_invalidate(cam_class_e cls);
+extern bool cam_set_mode_and_wait(uint8_t mode, TickType_t timeout);
+extern uint32_t cam_mode_switch_latency_us(void);
+extern void cam_frame_subscribe(TaskHandle_t task);
 
 #endif /* COMPONENTS_CAM_COMMU_H_ */
@@ -16,17 +16,21 @@
 /* User include files. */
 #include "danger_check.h"
 #include "mission.h"
+#include "ppm_encoder.h"
+#include "sonar.h"
 
 /*-----------------------------------------------------------*/
 /* private variables */
 /* danger check task handle structure, used for IRQ & TIMER send task notification. */
 static TaskHandle_t danger_check_taskhandle;
 static TimerHandle_t mission_tout_timerhandle;
+static const uint16_t emergency_ch[PPM_ENCODER_CHANNEL_NUM] = EMERGENCY_CHANNELS;
 
 /*-----------------------------------------------------------*/
 /* private functions declaration. */
 static void mission_timer_callback(TimerHandle_t mission_timer);
 static void danger_check_task_entry(void *pvParameters);
+static void sonar_check(void);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
@@ -49,6 +53,8 @@ void danger_check_init(void)
                       &danger_check_taskhandle);
     configASSERT(ret == pdPASS);
 
+    ppm_failsafe_preload(emergency_ch);
+
     mission_tout_timerhandle = xTimerCreate("mission_tout",
                                             MISSION_TOUT_TIME,
                                             pdFALSE,
@@ -82,13 +88,16 @@ void stop_mission_timer(void)
 
 /* ------------------------------------------------------------
  *
- * sends emergency remote signal to danger check task.
+ * switches the PPM output to the failsafe frame at once, and
+ * sends emergency remote signal to danger check task, which
+ * sets the same channels through the failsafe owner.
  *
  * ----------------------------------------------------------*/
 void IRQ0_IntHandler(void)
 {
     if(U_IRQ0_Pin_Read()) {
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        ppm_failsafe_trigger();
         vTaskNotifyGiveFromISR(danger_check_taskhandle, &xHigherPriorityTaskWoken);
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
@@ -99,9 +108,9 @@ void IRQ0_IntHandler(void)
 
 /* ------------------------------------------------------------
  *
- * the real danger check task. check attitude every 100ms, and
- * then wait for emergency signal from mission time out TIMER
- * or remote control.
+ * the real danger check task. check the sonar every echo
+ * timeout, and then wait for emergency signal from mission
+ * time out TIMER or remote control.
  *
  * ----------------------------------------------------------*/
 static void danger_check_task_entry(void *pvParameters)
@@ -109,9 +118,25 @@ static void danger_check_task_entry(void *pvParameters)
     while(1) {
         if(ulTaskNotifyTake(pdTRUE, DANGER_CHECK_TIME) != 0)
             is_emergency_now();
+        sonar_check();
     }
 }
 
+/* ------------------------------------------------------------
+ *
+ * Alt_Hold with the throttle up is taken as flying on the
+ * sonar, stale sonar data then switches to Land. the mode
+ * is sent again while the data stays stale.
+ *
+ * ----------------------------------------------------------*/
+static void sonar_check(void)
+{
+    if (ppm_channel_get(MODE_CHANNEL) != Alt_Hold) return;
+    if (ppm_channel_get(THROTTLE_CHANNEL) <= channel_val_MIN) return;
+    if (sonar_data_age_us() > DANGER_SONAR_MAX_AGE)
+        is_sonar_lost_now();
+}
+
 /* ------------------------------------------------------------
  *
  * the mission time out TIMER callback, it sends the emergency
@@ -8,8 +8,16 @@
 #ifndef COMPONENTS_DANGER_CHECK_H_
 #define COMPONENTS_DANGER_CHECK_H_
 
+#include "sonar.h"
+
 #define MISSION_TOUT_TIME   pdMS_TO_TICKS(120000)
-#define DANGER_CHECK_TIME   pdMS_TO_TICKS(250)
+#define DANGER_CHECK_TIME   pdMS_TO_TICKS(SONAR_ECHO_TIMEOUT_MS)
+/* older sonar data lands the copter, units: us. each echo ends
+ * within SONAR_ECHO_TIMEOUT_MS, and the filter stays valid over
+ * SONAR_MEDIAN_N / 2 missed echoes, so valid data comes at least
+ * that often while the sonar works. a check every
+ * DANGER_CHECK_TIME notices it one period later at most. */
+#define DANGER_SONAR_MAX_AGE ((SONAR_MEDIAN_N / 2 + 1) * SONAR_ECHO_TIMEOUT_MS * 1000UL)
 #define DANGER_TASK_PRI     6
 
 extern void danger_check_init(void);
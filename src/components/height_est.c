@@ -0,0 +1,125 @@
+/*
+ * height_est.c
+ */
+
+/* RTOS & rx23t include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform.h"
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "height_est.h"
+#include "height_kf.h"
+#include "alt_control.h"
+#include "ppm_encoder.h"
+#include "sonar.h"
+#include "timestamp.h"
+
+/*-----------------------------------------------------------*/
+/* private variables */
+static TaskHandle_t height_est_taskhandle;
+static struct height_kf height_kf;
+static struct height_estimate height_estimate;
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void height_est_task_entry(void *pvParameters);
+static void height_est_publish(uint32_t t_us, uint32_t sample_id, uint32_t samples, uint32_t rejected);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void height_est_init(void)
+{
+    BaseType_t ret;
+
+    height_kf_init(&height_kf, HEIGHT_EST_TAU, HEIGHT_EST_Q_H, HEIGHT_EST_Q_V,
+                   HEIGHT_EST_R, HEIGHT_EST_GATE, HEIGHT_EST_MAX_REJECT);
+    ret = xTaskCreate(height_est_task_entry,
+                      "height_est",
+                      configMINIMAL_STACK_SIZE,
+                      NULL,
+                      HEIGHT_EST_TASK_PRI,
+                      &height_est_taskhandle);
+    configASSERT(ret == pdPASS);
+}
+
+/* ----------------------------------------------------------
+ *
+ * copies the latest estimate, h, v & the covariance always
+ * belong to the same step.
+ *
+ * --------------------------------------------------------*/
+void height_est_read(struct height_estimate *est)
+{
+    taskENTER_CRITICAL();
+    *est = height_estimate;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * woken by each sonar sample, it predicts from the throttle
+ * last sent to the time of the sample & corrects with it. with
+ * no sample for a period it predicts to the present, so the
+ * covariance grows until the estimate is not valid.
+ *
+ * --------------------------------------------------------*/
+static void height_est_task_entry(void *pvParameters)
+{
+    struct sonar_sample s;
+    uint32_t last_id, used = 0, rejected = 0;
+    uint32_t t_us, last_us = timestamp_us();
+    int32_t dt_us;
+    float v_cmd;
+
+    sonar_read(&s);
+    last_id = s.id;
+    sonar_subscribe(xTaskGetCurrentTaskHandle());
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000/HEIGHT_EST_FREQ));
+        sonar_read(&s);
+        t_us = (s.id != last_id) ? s.t_us : timestamp_us();
+
+        /* a sample taken before the last prediction is applied there. */
+        dt_us = (int32_t)(t_us - last_us);
+        if (dt_us > 0) {
+            v_cmd = HEIGHT_EST_THR_TO_RATE * ((float)ppm_channel_get(THROTTLE_CHANNEL) - alt_ctl_hover_throttle());
+            height_kf_predict(&height_kf, v_cmd, (float)dt_us * 1e-6f);
+            last_us = t_us;
+        }
+
+        if (s.id != last_id) {
+            last_id = s.id;
+            if (s.valid) {
+                if (height_kf_update(&height_kf, s.height)) {
+                    used++;
+                } else {
+                    rejected++;
+                }
+            }
+        }
+        height_est_publish(last_us, last_id, used, rejected);
+    }
+}
+
+static void height_est_publish(uint32_t t_us, uint32_t sample_id, uint32_t samples, uint32_t rejected)
+{
+    taskENTER_CRITICAL();
+    height_estimate.h         = height_kf.h;
+    height_estimate.v         = height_kf.v;
+    height_estimate.p_hh      = height_kf.p_hh;
+    height_estimate.p_hv      = height_kf.p_hv;
+    height_estimate.p_vv      = height_kf.p_vv;
+    height_estimate.t_us      = t_us;
+    height_estimate.sample_id = sample_id;
+    height_estimate.samples   = samples;
+    height_estimate.rejected  = rejected;
+    height_estimate.valid     = height_kf.started && height_kf.p_hh < HEIGHT_EST_MAX_P_HH;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,46 @@
+/*
+ * height_est.h
+ */
+
+#ifndef COMPONENTS_HEIGHT_EST_H_
+#define COMPONENTS_HEIGHT_EST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HEIGHT_EST_TASK_PRI     5
+#define HEIGHT_EST_FREQ         50      /* predicts at least this often without sonar samples. */
+
+/* ----------------------------------------------------------
+ *
+ * model: in Alt_Hold the throttle stick commands a climb rate,
+ * linear around the hover throttle, which the copter follows
+ * with a first order lag.
+ *
+ * --------------------------------------------------------*/
+#define HEIGHT_EST_THR_TO_RATE  0.006f  /* units: (m/s) / ppm us */
+#define HEIGHT_EST_TAU          0.3f    /* units: s */
+#define HEIGHT_EST_Q_H          0.002f  /* units: m^2/s */
+#define HEIGHT_EST_Q_V          0.5f    /* units: (m/s)^2/s */
+#define HEIGHT_EST_R            0.0004f /* sonar noise, 2cm sigma, units: m^2 */
+#define HEIGHT_EST_GATE         4.0f    /* outlier gate, units: sigma */
+#define HEIGHT_EST_MAX_REJECT   5       /* outliers in a row that reset the filter. */
+#define HEIGHT_EST_MAX_P_HH     0.04f   /* above this the estimate is not valid, units: m^2 */
+
+struct height_estimate {
+    float    h;             /* units: m */
+    float    v;             /* units: m/s, up is positive. */
+    float    p_hh;          /* covariance of h & v. */
+    float    p_hv;
+    float    p_vv;
+    uint32_t t_us;          /* timestamp_us() of the estimate. */
+    uint32_t sample_id;     /* sonar_sample.id of the last sample folded in. */
+    uint32_t samples;       /* sonar samples used. */
+    uint32_t rejected;      /* sonar samples rejected as outliers. */
+    bool     valid;
+};
+
+extern void height_est_init(void);
+extern void height_est_read(struct height_estimate *est);
+
+#endif /* COMPONENTS_HEIGHT_EST_H_ */
@@ -16,9 +16,15 @@
 #include "io.h"
 #include "matrix_key.h"
 #include "mission.h"
+#include "cam_commu.h"
 #include "pos_control.h"
 #include "oled.h"
 #include "printf-stdarg.h"
+#include "serial_capture.h"
+#include "ppm_trace.h"
+#include "sonar.h"
+#include "ppm_encoder.h"
+#include "sbus_encoder.h"
 
 /*-----------------------------------------------------------*/
 /* private variables */
@@ -34,18 +40,23 @@ static uint8_t ScreenStr[3][8][30] = {
                                        "Mission 2",
                                        "Mission 3",
                                        "Mission 4",
-                                       "Mission 5"},
+                                       "Mission 5",
+                                       "Auto tune"},
                                       {"Height:",
                                        "pos kp:",
                                        "pos ki:",
-                                       "pos kd:",},
+                                       "pos kd:",
+                                       "gain sch:",
+                                       "tune rule:",},
 };
 static float ScreenData[3][8] = {
                                  {0.0,},
                                  {0.7,
                                   POS_KP,
                                   POS_KI,
-                                  POS_KD,},
+                                  POS_KD,
+                                  0.0,
+                                  AUTOTUNE_RULE_ZN,},
 };
 
 static int8_t selected_mission = -1;
@@ -64,6 +75,7 @@ static void key_up(void);
 static void key_down(void);
 static void process_input(int _key_tmp);
 static void process_number(float i);
+static void stats_dump(void);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
@@ -86,6 +98,37 @@ void io_input(void)
     xTaskNotifyGive(io_taskhandle);
 }
 
+/* ----------------------------------------------------------
+ *
+ * shows the auto-tune result, and loads the gains into the
+ * pos kp/ki/kd rows of the setting page. called by the
+ * mission task while the io task waits for io_input().
+ *
+ * --------------------------------------------------------*/
+void io_show_autotune(bool ok, float ku, float tu, float kp, float ki, float kd)
+{
+    oled_CLS();
+    if (!ok) {
+        oled_P6x8Str(8, 0, "Auto tune failed");
+        return;
+    }
+    ScreenData[MISSION_SETTING_PAGE][1] = kp;
+    ScreenData[MISSION_SETTING_PAGE][2] = ki;
+    ScreenData[MISSION_SETTING_PAGE][3] = kd;
+
+    oled_P6x8Str(8, 0, "Auto tune done");
+    oled_P6x8Str(8, 2, "ku:");
+    oled_PrintValueF(70, 2, ku, 2);
+    oled_P6x8Str(8, 3, "tu:");
+    oled_PrintValueF(70, 3, tu, 2);
+    oled_P6x8Str(8, 4, "pos kp:");
+    oled_PrintValueF(70, 4, kp, 2);
+    oled_P6x8Str(8, 5, "pos ki:");
+    oled_PrintValueF(70, 5, ki, 2);
+    oled_P6x8Str(8, 6, "pos kd:");
+    oled_PrintValueF(70, 6, kd, 2);
+}
+
 /*-----------------------------------------------------------*/
 /* private functions definition. */
 
@@ -116,6 +159,15 @@ static void io_task_entry(void *pvParameters)
                 case KEY_COMPELETE:
                     end_process();
                     break;
+                case KEY_LEFT:
+                    serial_capture_dump();
+                    break;
+                case KEY_RIGHT:
+                    ppm_trace_dump();
+                    break;
+                case KEY_STATS:
+                    stats_dump();
+                    break;
                 default:
                     break;
                 }
@@ -130,6 +182,8 @@ static void io_task_entry(void *pvParameters)
 static void end_process(void)
 {
     if (pageNum == MISSION_SETTING_PAGE) {
+        position_ctl_gain_schedule(ScreenData[MISSION_SETTING_PAGE][4] != 0.0f);
+        mission_autotune_rule_set((int)ScreenData[MISSION_SETTING_PAGE][5]);
         send_mission_params(selected_mission,
                             ScreenData[MISSION_SETTING_PAGE][0],
                             ScreenData[MISSION_SETTING_PAGE][1],
@@ -287,3 +341,30 @@ static void process_number(float i)
         break;
     }
 }
+
+/* ----------------------------------------------------------
+ *
+ * prints the timing the modules measure over the debug
+ * console, one line each.
+ *
+ * --------------------------------------------------------*/
+static void stats_dump(void)
+{
+    struct sonar_stats sst;
+    struct ppm_latency lat;
+
+    sonar_stats_read(&sst);
+    ppm_latency_read(&lat);
+    debug_printf("\nSTAT 1\n");
+    debug_printf("STAT CAM %d\n", (int)cam_mode_switch_latency_us());
+    debug_printf("STAT SONAR %d %d %d %d %d %d %d %d\n", (int)sst.echoes, (int)sst.dropped,
+                 (int)sst.out_of_range, (int)sst.missed, (int)sst.rate_limited,
+                 (int)sst.isr_us_max, (int)sst.filter_us_max, (int)sst.filter_us_avg);
+    debug_printf("STAT PPM %d %d %d %d %d\n", (int)lat.last_us, (int)lat.max_us,
+                 (int)lat.avg_us, (int)lat.frames, (int)lat.commands);
+    debug_printf("STAT FAILSAFE %d %d\n", (int)ppm_failsafe_active(), (int)ppm_failsafe_latency_us());
+#if PPM_OUTPUT_SBUS
+    debug_printf("STAT SBUS %d\n", (int)sbus_pack_us_max());
+#endif
+    debug_printf("STAT END\n");
+}
@@ -8,6 +8,8 @@
 #ifndef COMPONENTS_IO_H_
 #define COMPONENTS_IO_H_
 
+#include <stdbool.h>
+
 #define IO_TASK_PRI     1
 
 typedef enum {
@@ -20,6 +22,7 @@ typedef enum {
     KEY_DOWN = 10,
     KEY_LEFT = 5,
     KEY_RIGHT = 7,
+    KEY_STATS = 6,
     KEY_ENTER = 15,
     KEY_BACK = 13,
     KEY_COMPELETE = 16,
@@ -41,5 +44,6 @@ typedef enum {
 
 extern void io_init(void);
 extern void io_input(void);
+extern void io_show_autotune(bool ok, float ku, float tu, float kp, float ki, float kd);
 
 #endif /* COMPONENTS_IO_H_ */
@@ -31,6 +31,9 @@ static TaskHandle_t mission_taskhandle;
 static volatile float dest_Height;
 static volatile int8_t mission = -1;
 static volatile float mission_kp, mission_ki, mission_kd;
+static volatile autotune_rule_e mission_tune_rule = AUTOTUNE_RULE_ZN;
+/* NOTIFY_ bits received & not waited for yet, mission task only. */
+static uint32_t mission_events = 0;
 
 /*-----------------------------------------------------------*/
 /* private functions declaration. */
@@ -38,12 +41,19 @@ static void mission_task_entry(void *pvParameters);
 static void arm(uint16_t flight_mode);
 static void disarm(void);
 static void red_led_warning(void);
+static void mission_throttle(uint16_t throttle);
+static void mission_pitch(uint16_t pitch);
+static bool climb_to(const float dest_Height);
+static bool descend_to(const float height);
+static void mission_abort(void);
+static uint32_t mission_wait(uint32_t bits, TickType_t timeout);
 
 static void mission_1(const float dest_Height);
 static void mission_2(void);
 static void mission_3(const float dest_Height);
 static void mission_4(const float dest_Height);
 static void mission_5(const float dest_Height);
+static void mission_6(const float dest_Height);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
@@ -57,8 +67,28 @@ static void mission_5(const float dest_Height);
  * --------------------------------------------------------*/
 void is_emergency_now(void)
 {
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = EMERGENCY_CHANNELS;
+
     LED2 = LED_ON;
-    send_ppm(channel_val_MID,channel_val_MID,channel_val_MIN,channel_val_MID,Stabilize,EMERGENCY_ON);
+    ppm_channel_claim(PPM_OWNER_FAILSAFE, PPM_CH_ALL);
+    ppm_channel_update(PPM_OWNER_FAILSAFE, PPM_CH_ALL, ch);
+}
+
+/* ----------------------------------------------------------
+ *
+ * called by the danger check task when the sonar data gets
+ * stale in flight, the height is no longer known so the
+ * flight controller lands on its own.
+ *
+ * --------------------------------------------------------*/
+void is_sonar_lost_now(void)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    LED2 = LED_ON;
+    ch[MODE_CHANNEL] = Land;
+    ppm_channel_claim(PPM_OWNER_FAILSAFE, PPM_CH(MODE_CHANNEL));
+    ppm_channel_update(PPM_OWNER_FAILSAFE, PPM_CH(MODE_CHANNEL), ch);
 }
 
 /* ----------------------------------------------------------
@@ -115,6 +145,12 @@ void mission_timeout(void)
     xTaskNotify(mission_taskhandle, NOTIFY_CAR_STOP, eSetBits);
 }
 
+void mission_autotune_rule_set(int rule)
+{
+    if (rule < 0 || rule >= AUTOTUNE_RULE_NUM) rule = AUTOTUNE_RULE_ZN;
+    mission_tune_rule = (autotune_rule_e)rule;
+}
+
 /* ----------------------------------------------------------
  *
  * send start signal to the mission task.
@@ -124,7 +160,7 @@ void IRQ1_IntHandler(void)
 {
     if(U_IRQ1_Pin_Read()) {
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        vTaskNotifyGiveFromISR(mission_taskhandle, &xHigherPriorityTaskWoken);
+        xTaskNotifyFromISR(mission_taskhandle, NOTIFY_START_MISSION, eSetBits, &xHigherPriorityTaskWoken);
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);;
     }
 }
@@ -141,13 +177,14 @@ void IRQ1_IntHandler(void)
  * --------------------------------------------------------*/
 static void mission_task_entry(void *pvParameters)
 {
-    uint32_t ulNotifiedValue;
     while(1) {
         io_input();
-        while(1) {
-            xTaskNotifyWait(NOTIFY_ALL, NOTIFY_ALL, &ulNotifiedValue ,portMAX_DELAY);
-            if (ulNotifiedValue & NOTIFY_INPUT_OVER) break;
-        }
+        mission_wait(NOTIFY_INPUT_OVER, portMAX_DELAY);
+        /* events from before the mission are dropped. */
+        mission_events = 0;
+        /* a new mission takes the channels back from the failsafe. */
+        ppm_channel_release(PPM_OWNER_FAILSAFE, PPM_CH_ALL);
+        ppm_failsafe_clear();
         switch (mission) {
         case MISSION_1:
             red_led_warning();
@@ -176,6 +213,10 @@ static void mission_task_entry(void *pvParameters)
             mission_5(dest_Height);
             stop_mission_timer();
             break;
+        case MISSION_6:
+            red_led_warning();
+            mission_6(dest_Height);
+            break;
         default:
         /* select a mission number which does not exist. */
         break;
@@ -210,6 +251,38 @@ static void disarm(void)
     send_ppm(channel_val_MID,channel_val_MID,channel_val_MIN,channel_val_MID,Stabilize,EMERGENCY_OFF);
 }
 
+/* ----------------------------------------------------------
+ *
+ * sets the throttle in altitude hold mode, the other base
+ * channels are left as they are.
+ *
+ * --------------------------------------------------------*/
+static void mission_throttle(uint16_t throttle)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[THROTTLE_CHANNEL] = throttle;
+    ch[MODE_CHANNEL] = Alt_Hold;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(THROTTLE_CHANNEL) | PPM_CH(MODE_CHANNEL), ch);
+}
+
+/* ----------------------------------------------------------
+ *
+ * levels the roll & sets the pitch in altitude hold mode, for
+ * moves without the position control. throttle & the other
+ * base channels are left as they are.
+ *
+ * --------------------------------------------------------*/
+static void mission_pitch(uint16_t pitch)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[ROLL_CHANNEL] = channel_val_MID;
+    ch[PITCH_CHANNEL] = pitch;
+    ch[MODE_CHANNEL] = Alt_Hold;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL) | PPM_CH(MODE_CHANNEL), ch);
+}
+
 /* ----------------------------------------------------------
  *
  * the process in altitude hold mode, it is called by mission
@@ -220,33 +293,32 @@ static void disarm(void)
  * --------------------------------------------------------*/
 static void mission_1(const float dest_Height)
 {
-    float up_throttle;
     U_PORT_Camera_mode_select(CAM_MODE_BLACK);
     /* arm & clime up. */
     arm(Alt_Hold);
-    send_ppm(0,0,channel_percent(20),0,Alt_Hold,0);
+    mission_throttle(channel_percent(20));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
+    mission_throttle(channel_percent(50));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(55),0,Alt_Hold,0);
+    mission_throttle(channel_percent(55));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(60),0,Alt_Hold,0);
+    mission_throttle(channel_percent(60));
     vTaskDelay(pdMS_TO_TICKS(500));
 
     position_ctl_start(pdFALSE, mission_kp, mission_ki, mission_kd);
-    while(current_Height + DEST_HEIGHT_CUSHION < dest_Height) {
-        up_throttle = (1.0 - current_Height / dest_Height / 2) * channel_val_RANGE * 3 / 100;
-        send_ppm(0,0,channel_percent(60) + (uint16_t)up_throttle,0,Alt_Hold,0);
+    if (!climb_to(dest_Height)) {
+        mission_abort();
+        return;
     }
 
-    /* arrives the destination height, start position control & hold for x milliseconds. */
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
-    alt_ctl_start(dest_Height);
+    /* arrives the destination height, hold for x milliseconds. */
     vTaskDelay(pdMS_TO_TICKS(15000));
-    alt_ctl_stop();
     /* drop down & disarm. */
-    send_ppm(0,0,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.2);
+    if (!descend_to(0.2f)) {
+        mission_abort();
+        return;
+    }
+    alt_ctl_stop();
     position_ctl_stop();
     disarm();
 }
@@ -259,127 +331,216 @@ static void mission_2()
 
 static void mission_3(const float dest_Height)
 {
-    float up_throttle;
     U_PORT_Camera_mode_select(CAM_MODE_BLACK);
     /* arm & clime up. */
     arm(Alt_Hold);
-    send_ppm(0,0,channel_percent(20),0,Alt_Hold,0);
+    mission_throttle(channel_percent(20));
     vTaskDelay(pdMS_TO_TICKS(100));
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
+    mission_throttle(channel_percent(50));
     vTaskDelay(pdMS_TO_TICKS(100));
-    send_ppm(0,0,channel_percent(55),0,Alt_Hold,0);
+    mission_throttle(channel_percent(55));
     vTaskDelay(pdMS_TO_TICKS(200));
-    send_ppm(0,0,channel_percent(60),0,Alt_Hold,0);
+    mission_throttle(channel_percent(60));
     vTaskDelay(pdMS_TO_TICKS(100));
 
     position_ctl_start(pdFALSE, mission_kp, mission_ki, mission_kd);
     position_ctl_dest_set(CAMERA_MID_X, CAMERA_H);
-    while(current_Height + DEST_HEIGHT_CUSHION < dest_Height) {
-        up_throttle = (1.0 - current_Height / dest_Height / 2) * channel_val_RANGE * 3 / 100;
-        send_ppm(0,0,channel_percent(60) + (uint16_t)up_throttle,0,Alt_Hold,0);
+    if (!climb_to(dest_Height)) {
+        mission_abort();
+        return;
     }
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
 
-    /* go forward to find green car. */
-    U_PORT_Camera_mode_select(CAM_MODE_GREEN);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    mid_y = 0;
+    /* go forward to find green car, a camera that never switches
+     * to green would leave nothing to follow. */
+    if (!cam_set_mode_and_wait(CAM_MODE_GREEN, CAM_MODE_TIMEOUT)) {
+        mission_abort();
+        return;
+    }
+    position_ctl_track(CAM_CLASS_CAR);
+    position_ctl_lost_set(CAMERA_MID_X, 0);
     position_ctl_dest_set(CAMERA_MID_X, CAMERA_MID_Y);
     vTaskDelay(pdMS_TO_TICKS(15000));
 
     /* go forward & drop down & disarm. */
     position_ctl_stop();
-    send_ppm(channel_val_MID,channel_val_MID - 18,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.3);
-    send_ppm(channel_val_MID,channel_val_MID,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.1);
+    mission_pitch(channel_val_MID - 18);
+    if (!descend_to(0.3f)) {
+        mission_abort();
+        return;
+    }
+    mission_pitch(channel_val_MID);
+    if (!descend_to(0.1f)) {
+        mission_abort();
+        return;
+    }
+    alt_ctl_stop();
     disarm();
 }
 
 static void mission_4(const float dest_Height)
 {
-    uint32_t ulNotifiedValue;
-    float up_throttle;
     U_PORT_Camera_mode_select(CAM_MODE_BLACK);
     /* arm & clime up. */
     arm(Alt_Hold);
-    send_ppm(0,0,channel_percent(20),0,Alt_Hold,0);
+    mission_throttle(channel_percent(20));
     vTaskDelay(pdMS_TO_TICKS(100));
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
+    mission_throttle(channel_percent(50));
     vTaskDelay(pdMS_TO_TICKS(100));
-    send_ppm(0,0,channel_percent(55),0,Alt_Hold,0);
+    mission_throttle(channel_percent(55));
     vTaskDelay(pdMS_TO_TICKS(200));
-    send_ppm(0,0,channel_percent(60),0,Alt_Hold,0);
+    mission_throttle(channel_percent(60));
     vTaskDelay(pdMS_TO_TICKS(100));
 
     position_ctl_start(pdFALSE, mission_kp, mission_ki, mission_kd);
     position_ctl_dest_set(CAMERA_MID_X, CAMERA_H);
-    while(current_Height + DEST_HEIGHT_CUSHION < dest_Height) {
-        up_throttle = (1.0 - current_Height / dest_Height / 2) * channel_val_RANGE * 3 / 100;
-        send_ppm(0,0,channel_percent(60) + (uint16_t)up_throttle,0,Alt_Hold,0);
+    if (!climb_to(dest_Height)) {
+        mission_abort();
+        return;
     }
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
 
-    /* go forward to find green car. */
-    U_PORT_Camera_mode_select(CAM_MODE_GREEN);
-    vTaskDelay(pdMS_TO_TICKS(100));
-    mid_y = 0;
-    position_ctl_dest_set(CAMERA_MID_X, CAMERA_MID_Y);
-    while (1) {
-        xTaskNotifyWait(NOTIFY_ALL, NOTIFY_ALL, &ulNotifiedValue ,portMAX_DELAY);
-        if (ulNotifiedValue == NOTIFY_CAR_STOP) break;
+    /* go forward to find green car, a camera that never switches
+     * to green would leave nothing to follow. */
+    if (!cam_set_mode_and_wait(CAM_MODE_GREEN, CAM_MODE_TIMEOUT)) {
+        mission_abort();
+        return;
     }
+    position_ctl_track(CAM_CLASS_CAR);
+    position_ctl_lost_set(CAMERA_MID_X, 0);
+    position_ctl_dest_set(CAMERA_MID_X, CAMERA_MID_Y);
+    mission_wait(NOTIFY_CAR_STOP, portMAX_DELAY);
 
     /* go forward & drop down & disarm. */
     position_ctl_stop();
-    send_ppm(channel_val_MID,channel_val_MID + 18,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.3);
-    send_ppm(channel_val_MID,channel_val_MID,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.1);
+    mission_pitch(channel_val_MID + 18);
+    if (!descend_to(0.3f)) {
+        mission_abort();
+        return;
+    }
+    mission_pitch(channel_val_MID);
+    if (!descend_to(0.1f)) {
+        mission_abort();
+        return;
+    }
+    alt_ctl_stop();
     disarm();
 }
 
 static void mission_5(const float dest_Height)
 {
-    uint32_t ulNotifiedValue;
-    float up_throttle;
+    uint32_t events;
 
     U_PORT_Camera_mode_select(CAM_MODE_BLACK);
-    while (1) {
-        xTaskNotifyWait(NOTIFY_ALL, NOTIFY_ALL, &ulNotifiedValue ,portMAX_DELAY);
-        if (ulNotifiedValue & NOTIFY_MISSION_5) break;
-    }
+    mission_wait(NOTIFY_MISSION_5, portMAX_DELAY);
     /* arm & clime up. */
     arm(Alt_Hold);
-    send_ppm(0,0,channel_percent(20),0,Alt_Hold,0);
+    mission_throttle(channel_percent(20));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
+    mission_throttle(channel_percent(50));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(55),0,Alt_Hold,0);
+    mission_throttle(channel_percent(55));
     vTaskDelay(pdMS_TO_TICKS(500));
-    send_ppm(0,0,channel_percent(60),0,Alt_Hold,0);
+    mission_throttle(channel_percent(60));
     vTaskDelay(pdMS_TO_TICKS(500));
 
     position_ctl_start(pdFALSE, mission_kp, mission_ki, mission_kd);
-    while(current_Height + DEST_HEIGHT_CUSHION < dest_Height) {
-       up_throttle = (1.0 - current_Height / dest_Height / 2) * channel_val_RANGE * 3 / 100;
-       send_ppm(0,0,channel_percent(60) + (uint16_t)up_throttle,0,Alt_Hold,0);
+    if (!climb_to(dest_Height)) {
+        mission_abort();
+        return;
     }
 
-    /* arrives the destination height, start position control & hold for x milliseconds. */
-    send_ppm(0,0,channel_percent(50),0,Alt_Hold,0);
-    xTaskNotifyWait(NOTIFY_ALL, NOTIFY_ALL, &ulNotifiedValue ,pdMS_TO_TICKS(15000));
-    if (ulNotifiedValue & NOTIFY_M5_LEFT)
+    /* arrives the destination height, hold for x milliseconds. */
+    events = mission_wait(NOTIFY_M5_LEFT | NOTIFY_M5_STOP, pdMS_TO_TICKS(15000));
+    if (events & NOTIFY_M5_LEFT)
         position_ctl_dest_set(CAMERA_W / 10 * 8, CAMERA_MID_Y);
-    xTaskNotifyWait(NOTIFY_ALL, NOTIFY_ALL, &ulNotifiedValue ,pdMS_TO_TICKS(15000));
+    if (!(events & NOTIFY_M5_STOP))
+        mission_wait(NOTIFY_M5_STOP, pdMS_TO_TICKS(15000));
 
     /* drop down & disarm. */
-    send_ppm(0,0,channel_percent(38),0,Alt_Hold,0);
-    while(current_Height > 0.1);
+    if (!descend_to(0.1f)) {
+        mission_abort();
+        return;
+    }
+    alt_ctl_stop();
     position_ctl_stop();
     disarm();
 }
 
+/* ----------------------------------------------------------
+ *
+ * starts the altitude control & blocks until it has climbed
+ * to the destination along its profile, the height is held
+ * afterwards. the task sleeps meanwhile. returns false if it
+ * did not get there within MISSION_MOVE_TIMEOUT, the mission
+ * is then aborted.
+ *
+ * --------------------------------------------------------*/
+static bool climb_to(const float dest_Height)
+{
+    alt_ctl_start(dest_Height);
+    return alt_ctl_move_to(dest_Height, MISSION_MOVE_TIMEOUT);
+}
+
+/* ----------------------------------------------------------
+ *
+ * descends along the altitude profile, roll & pitch are left
+ * as they are. the altitude control keeps running. returns
+ * false on a timeout like climb_to().
+ *
+ * --------------------------------------------------------*/
+static bool descend_to(const float height)
+{
+    return alt_ctl_move_to(height, MISSION_MOVE_TIMEOUT);
+}
+
+/* ----------------------------------------------------------
+ *
+ * a move that did not end in time, the sonar height can not
+ * be trusted. the controls are stopped, the flight controller
+ * lands on its own as on a lost sonar, then the copter is
+ * disarmed. the next mission takes the channels back.
+ *
+ * --------------------------------------------------------*/
+static void mission_abort(void)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    is_sonar_lost_now();
+    position_ctl_stop();
+    /* the channels go back to the base owner, level & at hover. */
+    ch[ROLL_CHANNEL] = channel_val_MID;
+    ch[PITCH_CHANNEL] = channel_val_MID;
+    ch[THROTTLE_CHANNEL] = channel_val_MID;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL) | PPM_CH(THROTTLE_CHANNEL), ch);
+    alt_ctl_stop();
+    vTaskDelay(MISSION_LAND_TIME);
+    disarm();
+}
+
+/* ----------------------------------------------------------
+ *
+ * blocks until any of bits has been notified, or timeout, and
+ * returns those of bits received. every notification is moved
+ * into mission_events, only bits are taken out of it, so the
+ * other events stay for a later wait.
+ *
+ * --------------------------------------------------------*/
+static uint32_t mission_wait(uint32_t bits, TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed = 0;
+    uint32_t ulNotifiedValue, got;
+
+    while (!(mission_events & bits) && elapsed < timeout) {
+        if (xTaskNotifyWait(0, NOTIFY_ALL, &ulNotifiedValue,
+                            (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed) == pdTRUE)
+            mission_events |= ulNotifiedValue;
+        elapsed = xTaskGetTickCount() - start;
+    }
+    got = mission_events & bits;
+    mission_events &= ~got;
+    return got;
+}
+
 static void red_led_warning()
 {
     LED2 = LED_ON;
@@ -391,3 +552,53 @@ static void red_led_warning()
 //    vTaskDelay(pdMS_TO_TICKS(10000));
     LED2 = LED_OFF;
 }
+
+/* ----------------------------------------------------------
+ *
+ * auto-tune: climbs & holds the height like mission 1, runs
+ * the relay test on the position axis over the black line,
+ * lands, then shows the gains and loads them into the
+ * setting page for the next mission.
+ *
+ * --------------------------------------------------------*/
+static void mission_6(const float dest_Height)
+{
+    float ku, tu, kp = 0.0f, ki = 0.0f, kd = 0.0f;
+    bool ok;
+
+    U_PORT_Camera_mode_select(CAM_MODE_BLACK);
+    /* arm & clime up. */
+    arm(Alt_Hold);
+    mission_throttle(channel_percent(20));
+    vTaskDelay(pdMS_TO_TICKS(500));
+    mission_throttle(channel_percent(50));
+    vTaskDelay(pdMS_TO_TICKS(500));
+    mission_throttle(channel_percent(55));
+    vTaskDelay(pdMS_TO_TICKS(500));
+    mission_throttle(channel_percent(60));
+    vTaskDelay(pdMS_TO_TICKS(500));
+
+    position_ctl_start(pdFALSE, mission_kp, mission_ki, mission_kd);
+    if (!climb_to(dest_Height)) {
+        mission_abort();
+        return;
+    }
+
+    /* let the position settle, then oscillate one axis. */
+    vTaskDelay(pdMS_TO_TICKS(3000));
+    position_ctl_autotune_start(MISSION_TUNE_AXIS);
+    position_ctl_autotune_wait(MISSION_TUNE_TIME);
+    ok = position_ctl_autotune_result(mission_tune_rule, &ku, &tu, &kp, &ki, &kd);
+
+    /* drop down & disarm. */
+    if (!descend_to(0.2f)) {
+        mission_abort();
+        return;
+    }
+    alt_ctl_stop();
+    position_ctl_stop();
+    disarm();
+
+    io_show_autotune(ok, ku, tu, kp, ki, kd);
+    vTaskDelay(MISSION_TUNE_SHOW_TIME);
+}
@@ -8,9 +8,13 @@
 #ifndef COMPONENTS_MISSION_H_
 #define COMPONENTS_MISSION_H_
 
-#define DEST_HEIGHT_CUSHION 0.0f    /* units: meter */
+#define MISSION_MOVE_TIMEOUT    pdMS_TO_TICKS(10000)  /* of one climb or descent. */
+#define MISSION_LAND_TIME       pdMS_TO_TICKS(10000)  /* Land mode from SONAR_H_MAX at 0.5m/s & a margin. */
 
-#define MISSION_NUM         5
+/* the channels of the emergency, arm & disarm of the copter. */
+#define EMERGENCY_CHANNELS  {channel_val_MID,channel_val_MID,channel_val_MIN,channel_val_MID,Stabilize,channel_val_MIN,channel_val_MIN,EMERGENCY_ON}
+
+#define MISSION_NUM         6
 #define MISSION_TASK_PRI    3
 
 #define NOTIFY_START_MISSION    0x01
@@ -26,10 +30,16 @@ enum {
     MISSION_2 = 1,
     MISSION_3 = 2,
     MISSION_4 = 3,
-    MISSION_5 = 4
+    MISSION_5 = 4,
+    MISSION_6 = 5
 };
 
+#define MISSION_TUNE_AXIS       POS_AXIS_X
+#define MISSION_TUNE_TIME       pdMS_TO_TICKS(POS_TUNE_TIMEOUT_MS + 1000)
+#define MISSION_TUNE_SHOW_TIME  pdMS_TO_TICKS(5000)
+
 extern void is_emergency_now();
+extern void is_sonar_lost_now(void);
 extern void mission_init(void);
 extern void send_mission_params(int8_t _mission, float _dest_Height, float kp, float ki, float kd);
 extern void camera_finded(void);
@@ -38,5 +48,6 @@ extern void m5_start(void);
 extern void m5_stop(void);
 extern void m5_left(void);
 extern void mission_timeout(void);
+extern void mission_autotune_rule_set(int rule);
 
 #endif /* COMPONENTS_MISSION_H_ */
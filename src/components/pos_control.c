@@ -6,8 +6,10 @@
  */
 
 /* RTOS & rx23t include files. */
+#include <math.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "platform.h"
 #include "r_cg_sci.h"
 
@@ -18,19 +20,50 @@
 #include "ppm_encoder.h"
 #include "pid_control.h"
 #include "pos_control.h"
+#include "target_tracker.h"
+#include "timestamp.h"
+#include "gain_schedule.h"
+#include "pid_autotune.h"
 
 /*-----------------------------------------------------------*/
 /* private parameters */
-static struct pid_param position_x_pp;
-static struct pid_cfg   position_x_pc;
-static struct pid_param position_y_pp;
-static struct pid_cfg   position_y_pc;
-static TaskHandle_t pos_ctl_taskhandle;
+static struct pid2_param position_pp;     /* x & y share the gains. */
+static struct pid_bank position_pid;      /* POS_AXIS_X & POS_AXIS_Y. */
+static volatile float position_x_dest = (float)CAMERA_MID_X;
+static volatile float position_y_dest = (float)CAMERA_MID_Y;
+static TaskHandle_t pos_ctl_taskhandle = NULL;
+static struct target_tracker pos_tracker;
+/* the target position assumed while no fresh camera sample is available,
+ * until the target has been found, see position_ctl_lost_set(). */
+static volatile int lost_x = CAMERA_MID_X;
+static volatile int lost_y = CAMERA_MID_Y;
+static volatile bool pos_found = false;
+static volatile cam_class_e pos_class = CAM_CLASS_LINE;
+static const struct gain_point pos_gain_table[] = {
+    POS_GAIN_TABLE(GAIN_POINT)
+};
+static struct gain_schedule pos_gain_schedule;
+static struct pid_autotune pos_autotune;
+static volatile uint8_t pos_tune_axis = POS_AXIS_X;
+/* given when the auto-tune ends. */
+static SemaphoreHandle_t pos_tune_done = NULL;
+static volatile bool pos_use_schedule = false;
+/* gains from the keypad, scaled by the schedule. */
+static float pos_base_kp = POS_KP;
+static float pos_base_ki = POS_KI;
+static float pos_base_kd = POS_KD;
+/* what the bank was last configured for, see pos_gain_update(). */
+static bool  pos_cfg_valid = false;
+static bool  pos_cfg_schedule;
+static float pos_cfg_h;
+static float pos_cfg_dt;
 
 /*-----------------------------------------------------------*/
 /* private functions declaration. */
 static void pos_ctl_task_entry(void *pvParameters);
-static void pos_pid_init(struct pid_param *pp, struct pid_cfg *pc);
+static void pos_pid_init(struct pid2_param *pp);
+static void pos_gain_update(void);
+static void pos_tune_step(const float *setpoint, const float *measure);
 
 /*-----------------------------------------------------------*/
 /* global functions definition. */
@@ -38,20 +71,31 @@ void position_ctl_start(int use_Default_PID, float kp, float ki, float kd)
 {
     BaseType_t ret;
 
-    pos_pid_init(&position_x_pp, &position_x_pc);
-    pos_pid_init(&position_y_pp, &position_y_pc);
-    position_x_pc.destination = (float)CAMERA_MID_X;
-    position_y_pc.destination = (float)CAMERA_MID_Y;
-    position_x_pc.error_min = (float)POS_X_ERROR_MIN;
-    position_y_pc.error_min = (float)POS_Y_ERROR_MIN;
+    if (pos_tune_done == NULL) {
+        pos_tune_done = xSemaphoreCreateBinary();
+        configASSERT(pos_tune_done != NULL);
+    }
+    pos_pid_init(&position_pp);
+    pid_bank_init(&position_pid, POS_AXIS_NUM);
+    position_x_dest = (float)CAMERA_MID_X;
+    position_y_dest = (float)CAMERA_MID_Y;
+    lost_x = CAMERA_MID_X;
+    lost_y = CAMERA_MID_Y;
+    pos_found = false;
+    pos_class = CAM_CLASS_LINE;
+    tracker_init(&pos_tracker, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, (float)CAMERA_W, (float)CAMERA_H);
     if (!use_Default_PID) {
-        position_x_pp.kp = kp;
-        position_y_pp.kp = kp;
-        position_x_pp.ki = ki;
-        position_y_pp.ki = ki;
-        position_x_pp.kd = kd;
-        position_y_pp.kd = kd;
+        position_pp.kp = kp;
+        position_pp.ki = ki;
+        position_pp.kd = kd;
     }
+    pos_base_kp = position_pp.kp;
+    pos_base_ki = position_pp.ki;
+    pos_base_kd = position_pp.kd;
+    pos_cfg_valid = false;
+    gain_schedule_init(&pos_gain_schedule, pos_gain_table,
+                       sizeof(pos_gain_table) / sizeof(pos_gain_table[0]));
+    ppm_channel_claim(PPM_OWNER_POS, POS_PPM_CH);
 
     ret = xTaskCreate(pos_ctl_task_entry,
                       "pos_ctl",
@@ -64,51 +108,255 @@ void position_ctl_start(int use_Default_PID, float kp, float ki, float kd)
 
 void position_ctl_dest_set(int x_dest, int y_dest)
 {
-    position_x_pc.destination = (float)x_dest;
-    position_y_pc.destination = (float)y_dest;
+    position_x_dest = (float)x_dest;
+    position_y_dest = (float)y_dest;
+}
+
+/* ----------------------------------------------------------
+ *
+ * sets where the target is assumed to be while the camera has
+ * no fresh sample, e.g. y = 0 makes the copter fly forward
+ * until the target shows up. defaults to the image center.
+ * once the target has been found, a dropout holds its last
+ * valid position instead, until the next call or a new
+ * position_ctl_track() class searches again.
+ *
+ * --------------------------------------------------------*/
+void position_ctl_lost_set(int x_lost, int y_lost)
+{
+    taskENTER_CRITICAL();
+    lost_x = x_lost;
+    lost_y = y_lost;
+    pos_found = false;
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * selects which class of the camera target table is followed.
+ *
+ * --------------------------------------------------------*/
+void position_ctl_track(cam_class_e cls)
+{
+    pos_class = cls;
+}
+
+/* ----------------------------------------------------------
+ *
+ * scales the gains by POS_GAIN_TABLE at the current height.
+ * off by default, the base gains are then used as they are.
+ *
+ * --------------------------------------------------------*/
+void position_ctl_gain_schedule(bool enable)
+{
+    pos_use_schedule = enable;
+}
+
+/* ----------------------------------------------------------
+ *
+ * replaces the PID output of one axis by a relay until the
+ * ultimate gain & period are measured, the other axis is held
+ * by its PID. position_ctl_autotune_wait() returns when it
+ * ends, successfully or not.
+ * NOTE:position_ctl_start() first.
+ *
+ * --------------------------------------------------------*/
+void position_ctl_autotune_start(uint8_t axis)
+{
+    /* drop the end of an earlier tune nobody waited for. */
+    xSemaphoreTake(pos_tune_done, 0);
+    taskENTER_CRITICAL();
+    pos_tune_axis = axis;
+    autotune_start(&pos_autotune, POS_TUNE_AMP, POS_TUNE_HYST, POS_TUNE_CYCLES,
+                   timestamp_us(), POS_TUNE_TIMEOUT_MS);
+    taskEXIT_CRITICAL();
+}
+
+/* true if the auto-tune has ended within timeout. */
+bool position_ctl_autotune_wait(TickType_t timeout)
+{
+    return xSemaphoreTake(pos_tune_done, timeout) == pdTRUE;
 }
 
+bool position_ctl_autotune_result(autotune_rule_e rule, float *ku, float *tu,
+                                  float *kp, float *ki, float *kd)
+{
+    *ku = pos_autotune.ku;
+    *tu = pos_autotune.tu;
+    return autotune_gains(&pos_autotune, rule, kp, ki, kd);
+}
+
+/* does nothing if the position control is not running. */
 void position_ctl_stop(void)
 {
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    if (pos_ctl_taskhandle == NULL) return;
+#if POS_CAM_TRIGGERED
+    cam_frame_subscribe(NULL);
+#endif
     vTaskDelete(pos_ctl_taskhandle);
-    send_ppm(channel_val_MID, channel_val_MID, 0, 0, 0, 0);
+    pos_ctl_taskhandle = NULL;
+    ppm_channel_release(PPM_OWNER_POS, POS_PPM_CH);
+    /* level, the other base channels are left as they are. */
+    ch[ROLL_CHANNEL] = channel_val_MID;
+    ch[PITCH_CHANNEL] = channel_val_MID;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL), ch);
 }
 
 /*-----------------------------------------------------------*/
 /* private functions definition. */
 static void pos_ctl_task_entry(void *pvParameters)
 {
-    TickType_t xLastWakeTime;
-    xLastWakeTime = xTaskGetTickCount();
+    struct cam_target target;
+    uint16_t last_frame_id = 0;
+    cam_class_e cls, last_cls = pos_class;
+    float target_x, target_y;
+    float held_x = (float)CAMERA_MID_X, held_y = (float)CAMERA_MID_Y;
+    float setpoint[POS_AXIS_NUM], measure[POS_AXIS_NUM];
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+#if POS_CAM_TRIGGERED
+    uint32_t now_us, last_us = timestamp_us();
+    float dt;
+
+    cam_frame_subscribe(xTaskGetCurrentTaskHandle());
+#else
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+#endif
 
     while (1) {
+#if POS_CAM_TRIGGERED
+        /* released by each camera frame, or by the timeout when
+         * frames stop. dt is the time since the last update. */
+        ulTaskNotifyTake(pdTRUE, POS_CAM_TIMEOUT);
+        now_us = timestamp_us();
+        dt = (float)(now_us - last_us) * 1e-6f;
+        last_us = now_us;
+        if (dt < POS_DT_MIN) dt = POS_DT_MIN;
+        if (dt > POS_DT_MAX) dt = POS_DT_MAX;
+        position_pp.dt = dt;
+#endif
+        cls = pos_class;
+        if (cls != last_cls) {
+            last_cls = cls;
+            pos_found = false;
+            tracker_reset(&pos_tracker);
+        }
+
+        if (cam_target_get(cls, &target, POS_CAM_MAX_AGE)) {
+            target_x = (float)target.x;
+            target_y = (float)target.y;
+            held_x = target_x;
+            held_y = target_y;
+            pos_found = true;
+#if POS_USE_TRACKER
+            /* feed each frame once, at the time it was captured, then
+             * predict where the target is now. */
+            if (target.frame_id != last_frame_id || !pos_tracker.started) {
+                last_frame_id = target.frame_id;
+                tracker_update(&pos_tracker, target_x, target_y,
+                               target.rx_us - POS_CAM_LATENCY_MS * 1000UL);
+            }
+            tracker_predict(&pos_tracker, timestamp_us(), &target_x, &target_y);
+#endif
+        } else if (pos_found) {
+            target_x = held_x;
+            target_y = held_y;
+            tracker_reset(&pos_tracker);
+        } else {
+            target_x = (float)lost_x;
+            target_y = (float)lost_y;
+            tracker_reset(&pos_tracker);
+        }
+
         if(current_Height > POS_CTL_MIN_HEIGHT) {
             LED0 = LED_ON;
-            position_x_pc.error = ((float)mid_x - position_x_pc.destination) * PIXEL_TO_DISTANCE_X;
-            position_y_pc.error = ((float)mid_y - position_y_pc.destination) * PIXEL_TO_DISTANCE_Y;
-
-            pid_update(&position_x_pp, &position_x_pc);
-            pid_update(&position_y_pp, &position_y_pc);
+            pos_gain_update();
+            /* the error is target - destination, so both are fed
+             * negated, in cm. */
+            setpoint[POS_AXIS_X] = -position_x_dest * PIXEL_TO_DISTANCE_X;
+            setpoint[POS_AXIS_Y] = -position_y_dest * PIXEL_TO_DISTANCE_Y;
+            measure[POS_AXIS_X]  = -target_x * PIXEL_TO_DISTANCE_X;
+            measure[POS_AXIS_Y]  = -target_y * PIXEL_TO_DISTANCE_Y;
+            pid_bank_update(&position_pid, setpoint, measure, NULL);
+            if (pos_autotune.state == AUTOTUNE_RUNNING) pos_tune_step(setpoint, measure);
 
-            send_ppm((uint16_t)(channel_val_MID + (int)position_x_pc.pid_out),
-                     (uint16_t)(channel_val_MID + (int)position_y_pc.pid_out),
-                     0, 0, 0, 0);
+            ch[ROLL_CHANNEL]  = (uint16_t)(channel_val_MID + (int)position_pid.out[POS_AXIS_X]);
+            ch[PITCH_CHANNEL] = (uint16_t)(channel_val_MID + (int)position_pid.out[POS_AXIS_Y]);
         } else {
-            send_ppm(channel_val_MID, channel_val_MID, 0, 0, 0, 0);
+            pid_bank_reset(&position_pid, POS_AXIS_X);
+            pid_bank_reset(&position_pid, POS_AXIS_Y);
+            ch[ROLL_CHANNEL]  = channel_val_MID;
+            ch[PITCH_CHANNEL] = channel_val_MID;
             LED0 = LED_OFF;
         }
+        ppm_channel_update(PPM_OWNER_POS, POS_PPM_CH, ch);
 
+#if !POS_CAM_TRIGGERED
         vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(1000/POS_PID_FREQ));
+#endif
+    }
+}
+
+static void pos_tune_step(const float *setpoint, const float *measure)
+{
+    uint8_t axis = pos_tune_axis;
+
+    position_pid.out[axis] = autotune_update(&pos_autotune, setpoint[axis] - measure[axis],
+                                             timestamp_us());
+    if (pos_autotune.state == AUTOTUNE_RUNNING) return;
+
+    /* the PID took no part in the oscillation, start it afresh. */
+    pid_bank_reset(&position_pid, axis);
+    xSemaphoreGive(pos_tune_done);
+}
+
+/* ----------------------------------------------------------
+ *
+ * the bank is only configured again when the schedule is
+ * switched, the height has moved POS_GAIN_H_STEP or dt
+ * POS_DT_TOL from the last configuration. otherwise the
+ * products from then are kept.
+ *
+ * --------------------------------------------------------*/
+static void pos_gain_update(void)
+{
+    struct gain_point g;
+    bool schedule = pos_use_schedule;
+    float h = current_Height;
+
+    if (pos_cfg_valid && schedule == pos_cfg_schedule
+        && fabsf(position_pp.dt - pos_cfg_dt) <= POS_DT_TOL
+        && (!schedule || fabsf(h - pos_cfg_h) <= POS_GAIN_H_STEP))
+        return;
+    pos_cfg_valid    = true;
+    pos_cfg_schedule = schedule;
+    pos_cfg_h        = h;
+    pos_cfg_dt       = position_pp.dt;
+
+    if (schedule) {
+        gain_schedule_lookup(&pos_gain_schedule, h, &g);
+    } else {
+        g.kp = g.ki = g.kd = 1.0f;
+        g.out_max = POS_OUT_MAX;
     }
+    position_pp.kp      = pos_base_kp * g.kp;
+    position_pp.ki      = pos_base_ki * g.ki;
+    position_pp.kd      = pos_base_kd * g.kd;
+    position_pp.out_max = g.out_max;
+    pid_bank_configure(&position_pid, POS_AXIS_X, &position_pp);
+    pid_bank_configure(&position_pid, POS_AXIS_Y, &position_pp);
 }
 
-static void pos_pid_init(struct pid_param *pp, struct pid_cfg *pc)
+static void pos_pid_init(struct pid2_param *pp)
 {
-    pid_init(pp, pc);
+    pid2_param_init(pp);
     pp->kp = POS_KP;
     pp->ki = POS_KI;
     pp->kd = POS_KD;
     pp->dt = 1.0 / ((float)POS_PID_FREQ);
+    pp->b = POS_SP_WEIGHT;
+    pp->kaw = POS_AW_GAIN;
     pp->i_max = POS_I_MAX;
     pp->out_max = POS_OUT_MAX;
 }
@@ -8,14 +8,17 @@
 #ifndef COMPONENTS_POS_CONTROL_H_
 #define COMPONENTS_POS_CONTROL_H_
 
+#include "cam_commu.h"
+#include "pid_autotune.h"
+
 #define POS_KP          1.5f
 #define POS_KI          0.0f
 #define POS_KD          0.38f
 #define POS_I_MAX       15.0f
 #define POS_OUT_MAX     25.0f
 #define POS_PID_FREQ    50
-#define POS_X_ERROR_MIN 0
-#define POS_Y_ERROR_MIN 0
+#define POS_SP_WEIGHT   1.0f    /* setpoint weight of the proportional term. */
+#define POS_AW_GAIN     0.0f    /* anti-windup back-calculation gain, 0 selects ki / kp. */
 
 #define HEIGHT_TO_X             0.7333f
 #define HEIGHT_TO_Y             0.5111f
@@ -23,11 +26,54 @@
 #define PIXEL_TO_DISTANCE_Y     (current_Height * 100 * HEIGHT_TO_Y / (CAMERA_H / 2))
 
 #define POS_CTL_MIN_HEIGHT  0.2
+#define POS_CAM_MAX_AGE     pdMS_TO_TICKS(200)  /* older camera samples are not used. */
+#define POS_USE_TRACKER     1       /* act on the tracker prediction instead of the raw sample. */
+#define POS_CAM_LATENCY_MS  40      /* camera capture to frame received, units: ms */
+#define POS_CAM_TRIGGERED   1       /* run the loop on each camera frame, the fixed rate is the fallback. */
+#define POS_CAM_TIMEOUT     pdMS_TO_TICKS(1000/POS_PID_FREQ)
+#define POS_DT_MIN          0.005f  /* bounds of the measured dt, units: s */
+#define POS_DT_MAX          0.1f
+#define POS_DT_TOL          0.002f  /* dt changes the gains are configured again for, units: s */
+
+/* ----------------------------------------------------------
+ *
+ * gain schedule over height: height(m), kp, ki & kd scales of
+ * the base gains, out_max. the error is already in cm, so the
+ * camera noise grows with height & the gains come down.
+ *
+ * --------------------------------------------------------*/
+#define POS_GAIN_TABLE(X) \
+    X(0.2f, 1.40f, 1.00f, 1.20f, 30.0f) \
+    X(0.5f, 1.15f, 1.00f, 1.10f, 27.0f) \
+    X(0.8f, 1.00f, 1.00f, 1.00f, 25.0f) \
+    X(1.2f, 0.80f, 0.85f, 0.90f, 22.0f) \
+    X(1.6f, 0.65f, 0.70f, 0.80f, 20.0f)
+#define POS_GAIN_H_STEP     0.05f   /* height changes the schedule is looked up again for, units: m */
 
 #define POS_CTL_TASK_PRI    5
+#define POS_PPM_CH          (PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL))
+
+enum {
+    POS_AXIS_X = 0,
+    POS_AXIS_Y = 1,
+    POS_AXIS_NUM
+};
+
+/* relay auto-tune of one axis, see pid_autotune.h. */
+#define POS_TUNE_AMP        10.0f   /* relay output, units: ppm us */
+#define POS_TUNE_HYST       3.0f    /* units: cm */
+#define POS_TUNE_CYCLES     4
+#define POS_TUNE_TIMEOUT_MS 30000
 
 extern void position_ctl_start(int use_Default_PID, float kp, float ki, float kd);
 extern void position_ctl_dest_set(int x_dest, int y_dest);
+extern void position_ctl_lost_set(int x_lost, int y_lost);
+extern void position_ctl_track(cam_class_e cls);
+extern void position_ctl_gain_schedule(bool enable);
+extern void position_ctl_autotune_start(uint8_t axis);
+extern bool position_ctl_autotune_wait(TickType_t timeout);
+extern bool position_ctl_autotune_result(autotune_rule_e rule, float *ku, float *tu,
+                                         float *kp, float *ki, float *kd);
 extern void position_ctl_stop(void);
 
 #endif /* COMPONENTS_POS_CONTROL_H_ */
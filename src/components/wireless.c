@@ -19,6 +19,9 @@
 #include "pos_control.h"
 #include "mission.h"
 #include "sonar.h"
+#include "serial_stats.h"
+#include "serial_capture.h"
+#include "ppm_encoder.h"
 
 static TaskHandle_t car_commu_taskhandle;
 static unsigned char car_rx_buffer = 0;
@@ -38,8 +41,11 @@ void car_commu_init(void)
 {
     BaseType_t ret;
 
+#if !PPM_OUTPUT_SBUS
+    /* SCI5 sends SBUS otherwise. */
     R_SCI5_Serial_Receive(&car_rx_buffer, 1);
     R_SCI5_Start();
+#endif
 
     ret = xTaskCreate(car_commu_task_entry,
                       "car_commu",
@@ -55,21 +61,51 @@ void camera_finded(void)
     car_in_sight = pdTRUE;
 }
 
+/* ----------------------------------------------------------
+ *
+ * every command from the car is one byte, so a known command
+ * is a complete frame. other bytes, line noise or a command
+ * broken by an error, are counted as bytes only & leave the
+ * frame gap alone.
+ *
+ * --------------------------------------------------------*/
 void u_sci5_receiveend_callback(void)
 {
+    uint8_t cmd = car_rx_buffer;
+
     R_SCI5_Serial_Receive(&car_rx_buffer, 1);
+    serial_stats_rx_byte(SERIAL_PORT_CAR);
+    serial_capture_byte(SERIAL_PORT_CAR, cmd);
+    if (car_cmd_known(cmd)) {
+        serial_stats_frame_end(SERIAL_PORT_CAR);
+        serial_stats_frame(SERIAL_PORT_CAR, true);
+    }
 }
 
+void u_sci5_receiveerror_callback(uint8_t ssr)
+{
+    serial_stats_rx_error(SERIAL_PORT_CAR, ssr);
+}
+
+/* ----------------------------------------------------------
+ *
+ * the generated SCI5 code still calls this when SBUS is sent,
+ * the car task is not waiting then and is not notified.
+ *
+ * --------------------------------------------------------*/
 void u_sci5_transmitend_callback(void)
 {
+#if !PPM_OUTPUT_SBUS
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     vTaskNotifyGiveFromISR(car_commu_taskhandle, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#endif
 }
 
 static void car_commu_task_entry(void *pvParameters)
 {
     TickType_t xLastWakeTime;
+    struct cam_target target;
     xLastWakeTime = xTaskGetTickCount();
 
     while (1) {
@@ -90,13 +126,15 @@ static void car_commu_task_entry(void *pvParameters)
             m5_left();
         }
 
-        if (car_in_sight) {
+        if (car_in_sight && cam_target_get(CAM_CLASS_CAR, &target, POS_CAM_MAX_AGE)) {
             distance = sqrt(current_Height * current_Height
-                                      + ((float)(mid_x - CAMERA_MID_X) * PIXEL_TO_DISTANCE_X / 100) * ((float)(mid_x - CAMERA_MID_X) * PIXEL_TO_DISTANCE_X / 100)
-                                      + ((float)(mid_y - CAMERA_MID_Y) * PIXEL_TO_DISTANCE_Y / 100) * ((float)(mid_y - CAMERA_MID_Y) * PIXEL_TO_DISTANCE_Y / 100));
+                                      + ((float)(target.x - CAMERA_MID_X) * PIXEL_TO_DISTANCE_X / 100) * ((float)(target.x - CAMERA_MID_X) * PIXEL_TO_DISTANCE_X / 100)
+                                      + ((float)(target.y - CAMERA_MID_Y) * PIXEL_TO_DISTANCE_Y / 100) * ((float)(target.y - CAMERA_MID_Y) * PIXEL_TO_DISTANCE_Y / 100));
             if (distance < 1.51f && distance > 0.49f) {
+#if !PPM_OUTPUT_SBUS
                 R_SCI5_Serial_Send(&car_tx_buffer, 1);
                 ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+#endif
                 sound_light(1);
             } else {
                 sound_light(0);
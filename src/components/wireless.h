@@ -8,12 +8,7 @@
 #ifndef COMPONENTS_WIRELESS_H_
 #define COMPONENTS_WIRELESS_H_
 
-#define SOUND_LIGHT 0x38
-#define EMERGENCY   0x17
-#define CAR_STOP    0x25
-#define M5_START    0x9A
-#define M5_STOP     0x9B
-#define M5_LEFT     0x9C
+#include "car_cmd.h"
 
 
 #define CAR_COMMU_TASK_PRI  4
@@ -80,6 +80,7 @@
 #include "wireless.h"
 #include "mission.h"
 #include "sonar.h"
+#include "height_est.h"
 #include "io.h"
 
 /*-----------------------------------------------------------*/
@@ -133,6 +134,7 @@ static void init_task_entry(void *pvParameters)
 {
     io_init();
     sonar_init();
+    height_est_init();
     cam_commu_init();
     car_commu_init();
     ppm_encoder_init();
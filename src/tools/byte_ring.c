@@ -0,0 +1,63 @@
+/*
+ * byte_ring.c
+ */
+
+/* User include files. */
+#include "byte_ring.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void byte_ring_init(struct byte_ring *r, uint8_t *buf, uint16_t size)
+{
+    r->buf     = buf;
+    r->mask    = size - 1;
+    r->head    = 0;
+    r->tail    = 0;
+    r->dropped = 0;
+}
+
+/* ----------------------------------------------------------
+ *
+ * producer side, safe to call from interrupt. head & tail
+ * are free running, so head - tail is the number of bytes
+ * in the ring even after they wrap.
+ *
+ * --------------------------------------------------------*/
+bool byte_ring_put(struct byte_ring *r, uint8_t byte)
+{
+    uint16_t head = r->head;
+
+    if ((uint16_t)(head - r->tail) > r->mask) {
+        r->dropped++;
+        return false;
+    }
+    r->buf[head & r->mask] = byte;
+    /* publish the byte only after it is stored. */
+    r->head = head + 1;
+    return true;
+}
+
+/* ----------------------------------------------------------
+ *
+ * consumer side, copies at most max bytes into dst and
+ * returns how many were copied.
+ *
+ * --------------------------------------------------------*/
+uint16_t byte_ring_get(struct byte_ring *r, uint8_t *dst, uint16_t max)
+{
+    uint16_t tail = r->tail;
+    uint16_t n = (uint16_t)(r->head - tail);
+
+    if (n > max) n = max;
+    for (uint16_t i = 0; i < n; i++) {
+        dst[i] = r->buf[(tail + i) & r->mask];
+    }
+    r->tail = tail + n;
+    return n;
+}
+
+uint16_t byte_ring_count(const struct byte_ring *r)
+{
+    return (uint16_t)(r->head - r->tail);
+}
@@ -0,0 +1,33 @@
+/*
+ * byte_ring.h
+ */
+
+#ifndef TOOLS_BYTE_RING_H_
+#define TOOLS_BYTE_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------
+ *
+ * single-producer/single-consumer byte ring. the producer is
+ * normally a receive interrupt and the consumer a task, so
+ * head is only written by the producer and tail only by the
+ * consumer, no lock is needed.
+ * NOTE:size must be a power of two, and at most 32768.
+ *
+ * --------------------------------------------------------*/
+struct byte_ring {
+    uint8_t *buf;
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint32_t dropped;  /* bytes lost because the ring was full. */
+};
+
+extern void byte_ring_init(struct byte_ring *r, uint8_t *buf, uint16_t size);
+extern bool byte_ring_put(struct byte_ring *r, uint8_t byte);
+extern uint16_t byte_ring_get(struct byte_ring *r, uint8_t *dst, uint16_t max);
+extern uint16_t byte_ring_count(const struct byte_ring *r);
+
+#endif /* TOOLS_BYTE_RING_H_ */
@@ -0,0 +1,223 @@
+/*
+ * cam_frame.c
+ */
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "cam_frame.h"
+#include "crc8.h"
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static bool cam_decode_payload(const struct cam_parser *ps, struct cam_frame *f);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+void cam_parser_init(struct cam_parser *ps, uint8_t mode)
+{
+    ps->state = CAM_PS_IDLE;
+    ps->mode = mode;
+    ps->last_version = 0;
+    ps->last_seq = 0;
+}
+
+/* ----------------------------------------------------------
+ *
+ * returns CAM_PARSE_FRAME when a complete, valid & new frame
+ * has been decoded into f. STX only restarts a frame outside
+ * the v2 body, since it may appear in the v2 payload or crc.
+ * a frame repeating the sequence number of the last one is a
+ * duplicate, legacy frames have no sequence number.
+ *
+ * --------------------------------------------------------*/
+cam_parse_e cam_parse_byte(struct cam_parser *ps, uint8_t byte, struct cam_frame *f)
+{
+    switch (ps->state) {
+    case CAM_PS_IDLE:
+        if (byte == COMMUNI_STX) ps->state = CAM_PS_HEAD;
+        break;
+    case CAM_PS_HEAD:
+        if (byte == CAM_FRAME_VER_2 || byte == CAM_FRAME_VER_3) {
+            ps->version = byte;
+            ps->crc = crc8_update(CRC8_INIT, byte);
+            ps->state = CAM_PS_LEN;
+        } else if (byte < CAMERA_W) {
+            ps->legacy_x = byte;
+            ps->state = CAM_PS_LEGACY_Y;
+        } else if (byte != COMMUNI_STX) {
+            ps->state = CAM_PS_IDLE;
+        }
+        break;
+    case CAM_PS_LEGACY_Y:
+        if (byte == COMMUNI_STX) {
+            ps->state = CAM_PS_HEAD;
+            break;
+        }
+        ps->state = CAM_PS_IDLE;
+        if (byte >= CAMERA_H) return CAM_PARSE_BAD;
+        f->version            = 1;
+        f->seq                = 0;
+        f->timestamp          = 0;
+        f->blob_num           = 1;
+        f->mode               = CAM_MODE_UNKNOWN;
+        f->blob[0].cls        = cam_mode_class(ps->mode);
+        f->blob[0].x          = ps->legacy_x;
+        f->blob[0].y          = byte;
+        f->blob[0].area       = 0;
+        f->blob[0].confidence = 0xFF;
+        ps->last_version = 1;
+        return CAM_PARSE_FRAME;
+    case CAM_PS_LEN:
+        if (byte > CAM_MAX_PAYLOAD_LEN) {
+            ps->state = (byte == COMMUNI_STX) ? CAM_PS_HEAD : CAM_PS_IDLE;
+            return CAM_PARSE_BAD;
+        }
+        ps->len = byte;
+        ps->idx = 0;
+        ps->crc = crc8_update(ps->crc, byte);
+        ps->state = byte ? CAM_PS_PAYLOAD : CAM_PS_CRC;
+        break;
+    case CAM_PS_PAYLOAD:
+        ps->payload[ps->idx++] = byte;
+        ps->crc = crc8_update(ps->crc, byte);
+        if (ps->idx >= ps->len) ps->state = CAM_PS_CRC;
+        break;
+    case CAM_PS_CRC:
+        ps->state = CAM_PS_IDLE;
+        if (byte != ps->crc || !cam_decode_payload(ps, f)) return CAM_PARSE_BAD;
+        if (ps->last_version == f->version && ps->last_seq == f->seq) return CAM_PARSE_DUP;
+        ps->last_version = f->version;
+        ps->last_seq = f->seq;
+        return CAM_PARSE_FRAME;
+    default:
+        ps->state = CAM_PS_IDLE;
+        break;
+    }
+    return CAM_PARSE_MORE;
+}
+
+/* ----------------------------------------------------------
+ *
+ * returns true at the last byte of a frame. the length is
+ * known after the version & len bytes, a bad len is left to
+ * the parser. an STX before the pending frame is complete
+ * restarts the count, so a corrupted len byte costs one frame
+ * only. an STX inside a v2 payload restarts it too, which
+ * ends that frame late.
+ *
+ * --------------------------------------------------------*/
+bool cam_track_byte(struct cam_track *t, uint8_t byte)
+{
+    if (byte == COMMUNI_STX && t->bytes + 1 < t->len)
+        t->bytes = 0;
+    if (t->bytes == 0) {
+        if (byte == COMMUNI_STX) {
+            t->bytes = 1;
+            t->len = CAM_FRAME_LENGTH;
+        }
+        return false;
+    }
+    t->bytes++;
+    if (t->bytes == 2 && (byte == CAM_FRAME_VER_2 || byte == CAM_FRAME_VER_3)) {
+        t->len = 0xFF;
+    } else if (t->bytes == 3 && t->len == 0xFF) {
+        /* STX, version, len, payload, crc. */
+        t->len = (byte <= CAM_MAX_PAYLOAD_LEN) ? 4 + byte : 3;
+    }
+    if (t->bytes >= t->len) {
+        t->bytes = 0;
+        return true;
+    }
+    return false;
+}
+
+cam_class_e cam_mode_class(uint8_t mode)
+{
+    return (mode == CAM_MODE_GREEN) ? CAM_CLASS_CAR : CAM_CLASS_LINE;
+}
+
+/* ----------------------------------------------------------
+ *
+ * writes the blobs of f into the target table. a v3 frame
+ * lists every blob in sight, so the classes it leaves out are
+ * invalidated, legacy & v2 frames only touch their own class.
+ *
+ * --------------------------------------------------------*/
+void cam_table_update(struct cam_target *table, const struct cam_frame *f,
+                      uint16_t frame_id, uint32_t rx_tick, uint32_t rx_us)
+{
+    if (f->version == CAM_FRAME_VER_3) {
+        for (int i = 0; i < CAM_CLASS_NUM; i++)
+            table[i].valid = false;
+    }
+    for (uint8_t i = 0; i < f->blob_num; i++) {
+        struct cam_target *t = &table[f->blob[i].cls];
+        t->x          = f->blob[i].x;
+        t->y          = f->blob[i].y;
+        t->valid      = true;
+        t->confidence = f->blob[i].confidence;
+        t->area       = f->blob[i].area;
+        t->frame_id   = frame_id;
+        t->rx_tick    = rx_tick;
+        t->rx_us      = rx_us;
+    }
+}
+
+/* true if t is valid & not older than max_age ticks. */
+bool cam_target_fresh(const struct cam_target *t, uint32_t now_tick, uint32_t max_age)
+{
+    return t->valid && now_tick - t->rx_tick <= max_age;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * v2 & v3 share the seq & timestamp header, a v2 frame is one
+ * blob of the class selected by the camera mode, the mode in
+ * the frame if it has one. blobs out of the image or of an
+ * unknown class are skipped.
+ *
+ * --------------------------------------------------------*/
+static bool cam_decode_payload(const struct cam_parser *ps, struct cam_frame *f)
+{
+    const uint8_t *p = ps->payload;
+    uint8_t count;
+
+    f->version   = ps->version;
+    f->seq       = p[0];
+    f->timestamp = (uint16_t)(p[1] | (p[2] << 8));
+    f->mode      = CAM_MODE_UNKNOWN;
+    f->blob_num  = 0;
+
+    if (ps->version == CAM_FRAME_VER_2) {
+        if (ps->len < CAM_V2_PAYLOAD_LEN) return false;
+        if (p[3] >= CAMERA_W || p[4] >= CAMERA_H) return false;
+        if (ps->len > CAM_V2_PAYLOAD_LEN) f->mode = p[CAM_V2_PAYLOAD_LEN];
+        f->blob[0].cls        = cam_mode_class(f->mode != CAM_MODE_UNKNOWN ? f->mode : ps->mode);
+        f->blob[0].x          = p[3];
+        f->blob[0].y          = p[4];
+        f->blob[0].area       = (uint16_t)(p[5] | (p[6] << 8));
+        f->blob[0].confidence = p[7];
+        f->blob_num = 1;
+        return true;
+    }
+
+    if (ps->len < CAM_V3_HEAD_LEN) return false;
+    count = p[3];
+    if (count > CAM_MAX_BLOBS || ps->len < CAM_V3_HEAD_LEN + count * CAM_V3_BLOB_LEN) return false;
+    if (ps->len > CAM_V3_HEAD_LEN + count * CAM_V3_BLOB_LEN)
+        f->mode = p[CAM_V3_HEAD_LEN + count * CAM_V3_BLOB_LEN];
+    p += CAM_V3_HEAD_LEN;
+    for (uint8_t i = 0; i < count; i++, p += CAM_V3_BLOB_LEN) {
+        if (p[0] >= CAM_CLASS_NUM || p[1] >= CAMERA_W || p[2] >= CAMERA_H) continue;
+        f->blob[f->blob_num].cls        = p[0];
+        f->blob[f->blob_num].x          = p[1];
+        f->blob[f->blob_num].y          = p[2];
+        f->blob[f->blob_num].area       = (uint16_t)(p[3] | (p[4] << 8));
+        f->blob[f->blob_num].confidence = p[5];
+        f->blob_num++;
+    }
+    return true;
+}
@@ -0,0 +1,144 @@
+/*
+ * cam_frame.h
+ */
+
+#ifndef TOOLS_CAM_FRAME_H_
+#define TOOLS_CAM_FRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CAMERA_W            160
+#define CAMERA_H            120
+#define CAMERA_MID_X        79
+#define CAMERA_MID_Y        59
+
+/* ----------------------------------------------------------
+ *
+ * camera frames, all start with COMMUNI_STX:
+ *  legacy: STX, x, y
+ *  v2/v3:  STX, version, len, payload[len], crc8
+ * the version byte is out of the x range, so legacy frames
+ * can be told apart by the byte after STX. crc8 covers
+ * version, len & payload. payloads are little endian:
+ *  v2: seq, timestamp(2, camera ms), x, y, area(2), confidence,
+ *      [mode]
+ *  v3: seq, timestamp(2, camera ms), blob count,
+ *      count * (class, x, y, area(2), confidence), [mode]
+ * a v3 frame lists every blob the camera sees, a class not
+ * in it is not in sight. the optional trailing mode byte is
+ * the camera mode the frame was taken in.
+ *
+ * --------------------------------------------------------*/
+#define COMMUNI_STX         0xFE
+#define CAM_FRAME_LENGTH    3
+#define CAM_FRAME_VER_2     0xF2
+#define CAM_FRAME_VER_3     0xF3
+#define CAM_V2_PAYLOAD_LEN  8
+#define CAM_V3_HEAD_LEN     4
+#define CAM_V3_BLOB_LEN     6
+#define CAM_MAX_BLOBS       4
+#define CAM_MAX_PAYLOAD_LEN 32
+
+#define CAM_MODE_BLACK      1
+#define CAM_MODE_GREEN      0
+#define CAM_MODE_UNKNOWN    0xFF    /* frame carries no mode. */
+
+/* blob classes, legacy & v2 frames carry one blob whose class
+ * follows the camera mode. */
+typedef enum {
+    CAM_CLASS_LINE = 0,
+    CAM_CLASS_CAR = 1,
+    CAM_CLASS_NUM
+} cam_class_e;
+
+struct cam_blob {
+    uint8_t  cls;
+    uint8_t  x;
+    uint8_t  y;
+    uint8_t  confidence;
+    uint16_t area;          /* units: pixel */
+};
+
+struct cam_frame {
+    uint8_t  version;       /* 1 for legacy frames. */
+    uint8_t  seq;
+    uint16_t timestamp;     /* camera capture time, units: ms */
+    uint8_t  mode;
+    uint8_t  blob_num;
+    struct cam_blob blob[CAM_MAX_BLOBS];
+};
+
+/* ----------------------------------------------------------
+ *
+ * the latest position of one target class, a table of
+ * CAM_CLASS_NUM of them is indexed by class.
+ *
+ * --------------------------------------------------------*/
+struct cam_target {
+    uint8_t    x;
+    uint8_t    y;
+    bool       valid;
+    uint8_t    confidence;
+    uint16_t   area;
+    uint16_t   frame_id;    /* counts every accepted frame. */
+    uint32_t   rx_tick;     /* RTOS tick count when the frame was received. */
+    uint32_t   rx_us;       /* timestamp_us() when the frame was received. */
+};
+
+/* ----------------------------------------------------------
+ *
+ * incremental frame parser, fed one byte at a time. mode is
+ * the camera mode selected by the port, it gives the class
+ * of legacy & v2 blobs when the frame carries no mode.
+ *
+ * --------------------------------------------------------*/
+typedef enum {
+    CAM_PS_IDLE,
+    CAM_PS_HEAD,
+    CAM_PS_LEGACY_Y,
+    CAM_PS_LEN,
+    CAM_PS_PAYLOAD,
+    CAM_PS_CRC,
+} cam_parse_state_e;
+
+typedef enum {
+    CAM_PARSE_MORE,         /* no frame ended at this byte. */
+    CAM_PARSE_FRAME,        /* a valid & new frame is decoded. */
+    CAM_PARSE_BAD,          /* a frame failed the range, length or crc check. */
+    CAM_PARSE_DUP,          /* a valid frame repeats the last sequence number. */
+} cam_parse_e;
+
+struct cam_parser {
+    cam_parse_state_e state;
+    uint8_t mode;
+    uint8_t version;
+    uint8_t len;
+    uint8_t idx;
+    uint8_t crc;
+    uint8_t legacy_x;
+    uint8_t last_version;
+    uint8_t last_seq;
+    uint8_t payload[CAM_MAX_PAYLOAD_LEN];
+};
+
+/* ----------------------------------------------------------
+ *
+ * frame end tracker of the receive interrupt, it only counts
+ * bytes, so the parser task can be woken once per frame.
+ *
+ * --------------------------------------------------------*/
+struct cam_track {
+    uint8_t bytes;          /* of the pending frame, 0 if none. */
+    uint8_t len;
+};
+
+extern void cam_parser_init(struct cam_parser *ps, uint8_t mode);
+extern cam_parse_e cam_parse_byte(struct cam_parser *ps, uint8_t byte, struct cam_frame *f);
+extern bool cam_track_byte(struct cam_track *t, uint8_t byte);
+extern cam_class_e cam_mode_class(uint8_t mode);
+extern void cam_table_update(struct cam_target *table, const struct cam_frame *f,
+                             uint16_t frame_id, uint32_t rx_tick, uint32_t rx_us);
+extern bool cam_target_fresh(const struct cam_target *t, uint32_t now_tick, uint32_t max_age);
+
+#endif /* TOOLS_CAM_FRAME_H_ */
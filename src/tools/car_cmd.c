@@ -0,0 +1,17 @@
+/*
+ * car_cmd.c
+ */
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "car_cmd.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* true if cmd is one of the commands the car sends. */
+bool car_cmd_known(uint8_t cmd)
+{
+    return cmd == CAR_STOP || cmd == EMERGENCY
+           || cmd == M5_START || cmd == M5_STOP || cmd == M5_LEFT;
+}
@@ -0,0 +1,26 @@
+/*
+ * car_cmd.h
+ */
+
+#ifndef TOOLS_CAR_CMD_H_
+#define TOOLS_CAR_CMD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------
+ *
+ * the car link (SCI5) has no framing, every byte the car sends
+ * is one command on its own. SOUND_LIGHT goes the other way.
+ *
+ * --------------------------------------------------------*/
+#define SOUND_LIGHT 0x38
+#define EMERGENCY   0x17
+#define CAR_STOP    0x25
+#define M5_START    0x9A
+#define M5_STOP     0x9B
+#define M5_LEFT     0x9C
+
+extern bool car_cmd_known(uint8_t cmd);
+
+#endif /* TOOLS_CAR_CMD_H_ */
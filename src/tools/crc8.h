@@ -0,0 +1,15 @@
+/*
+ * crc8.h
+ */
+
+#ifndef TOOLS_CRC8_H_
+#define TOOLS_CRC8_H_
+
+#include <stdint.h>
+
+#define CRC8_INIT   0x00
+
+extern uint8_t crc8_update(uint8_t crc, uint8_t byte);
+extern uint8_t crc8_calc(const uint8_t *data, uint16_t len);
+
+#endif /* TOOLS_CRC8_H_ */
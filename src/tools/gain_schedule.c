@@ -0,0 +1,49 @@
+/*
+ * gain_schedule.c
+ */
+
+/* User include files. */
+#include "gain_schedule.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void gain_schedule_init(struct gain_schedule *gs, const struct gain_point *pt, uint8_t num)
+{
+    if (num > GAIN_SCHED_MAX_POINTS) num = GAIN_SCHED_MAX_POINTS;
+    gs->pt  = pt;
+    gs->num = num;
+    for (uint8_t i = 0; i + 1 < num; i++) {
+        float dh = pt[i + 1].h - pt[i].h;
+        gs->inv_dh[i] = (dh > 0.0f) ? 1.0f / dh : 0.0f;
+    }
+}
+
+void gain_schedule_lookup(const struct gain_schedule *gs, float h, struct gain_point *out)
+{
+    const struct gain_point *a, *b;
+    uint8_t i = 0;
+    float t;
+
+    if (gs->num == 0) return;
+    if (h <= gs->pt[0].h || gs->num == 1) {
+        *out = gs->pt[0];
+        out->h = h;
+        return;
+    }
+    while (i + 1 < gs->num && h >= gs->pt[i + 1].h) i++;
+    if (i + 1 >= gs->num) {
+        *out = gs->pt[gs->num - 1];
+        out->h = h;
+        return;
+    }
+
+    a = &gs->pt[i];
+    b = &gs->pt[i + 1];
+    t = (h - a->h) * gs->inv_dh[i];
+    out->h       = h;
+    out->kp      = a->kp      + t * (b->kp      - a->kp);
+    out->ki      = a->ki      + t * (b->ki      - a->ki);
+    out->kd      = a->kd      + t * (b->kd      - a->kd);
+    out->out_max = a->out_max + t * (b->out_max - a->out_max);
+}
@@ -0,0 +1,41 @@
+/*
+ * gain_schedule.h
+ */
+
+#ifndef TOOLS_GAIN_SCHEDULE_H_
+#define TOOLS_GAIN_SCHEDULE_H_
+
+#include <stdint.h>
+
+#define GAIN_SCHED_MAX_POINTS   8
+
+/* one breakpoint, the gains are scales of the base gains. */
+struct gain_point {
+    float h;            /* units: meter */
+    float kp;
+    float ki;
+    float kd;
+    float out_max;
+};
+
+/* ----------------------------------------------------------
+ *
+ * piecewise linear gains over height. the breakpoints must be
+ * sorted by h. the inverse width of each segment is computed
+ * once by gain_schedule_init(), so a lookup has no division.
+ * outside the table the first or last point is held.
+ *
+ * --------------------------------------------------------*/
+struct gain_schedule {
+    const struct gain_point *pt;
+    float   inv_dh[GAIN_SCHED_MAX_POINTS - 1];
+    uint8_t num;
+};
+
+/* expands a POS_GAIN_TABLE style X-macro row into an initializer. */
+#define GAIN_POINT(h, kp, ki, kd, out_max)  {h, kp, ki, kd, out_max},
+
+extern void gain_schedule_init(struct gain_schedule *gs, const struct gain_point *pt, uint8_t num);
+extern void gain_schedule_lookup(const struct gain_schedule *gs, float h, struct gain_point *out);
+
+#endif /* TOOLS_GAIN_SCHEDULE_H_ */
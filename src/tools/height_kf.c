@@ -0,0 +1,100 @@
+/*
+ * height_kf.c
+ */
+
+/* User include files. */
+#include "height_kf.h"
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void height_kf_reset(struct height_kf *kf, float z);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void height_kf_init(struct height_kf *kf, float tau, float q_h, float q_v, float r, float gate,
+                    unsigned char max_reject)
+{
+    kf->tau        = tau;
+    kf->q_h        = q_h;
+    kf->q_v        = q_v;
+    kf->r          = r;
+    kf->gate       = gate;
+    kf->p_init     = 1.0f;
+    kf->max_reject = max_reject;
+    height_kf_reset(kf, 0.0f);
+    /* the first measurement starts it. */
+    kf->started    = false;
+}
+
+void height_kf_predict(struct height_kf *kf, float v_cmd, float dt)
+{
+    float a = dt / kf->tau;
+    float f = 1.0f - a;         /* dv'/dv */
+    float p_hh, p_hv, p_vv;
+
+    if (!kf->started) return;
+    kf->h += kf->v * dt;
+    kf->v += (v_cmd - kf->v) * a;
+    /* the ground stops a descent. */
+    if (kf->h < 0.0f) {
+        kf->h = 0.0f;
+        if (kf->v < 0.0f) kf->v = 0.0f;
+    }
+
+    // P = F * P * F' + Q, F = [1 dt; 0 f]
+    p_hh = kf->p_hh + 2.0f * dt * kf->p_hv + dt * dt * kf->p_vv + kf->q_h * dt;
+    p_hv = f * (kf->p_hv + dt * kf->p_vv);
+    p_vv = f * f * kf->p_vv + kf->q_v * dt;
+    kf->p_hh = p_hh;
+    kf->p_hv = p_hv;
+    kf->p_vv = p_vv;
+}
+
+/* ----------------------------------------------------------
+ *
+ * returns false if z was rejected as an outlier.
+ *
+ * --------------------------------------------------------*/
+bool height_kf_update(struct height_kf *kf, float z)
+{
+    float y, s, k_h, k_v;
+
+    if (!kf->started) {
+        height_kf_reset(kf, z);
+        return true;
+    }
+
+    y = z - kf->h;
+    s = kf->p_hh + kf->r;
+    if (y * y > kf->gate * kf->gate * s) {
+        if (++kf->rejects < kf->max_reject) return false;
+        /* the filter is lost, not the sonar. */
+        height_kf_reset(kf, z);
+        return true;
+    }
+    kf->rejects = 0;
+
+    k_h = kf->p_hh / s;
+    k_v = kf->p_hv / s;
+    kf->h += k_h * y;
+    kf->v += k_v * y;
+    kf->p_vv -= k_v * kf->p_hv;
+    kf->p_hv *= 1.0f - k_h;
+    kf->p_hh *= 1.0f - k_h;
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+static void height_kf_reset(struct height_kf *kf, float z)
+{
+    kf->h       = z;
+    kf->v       = 0.0f;
+    kf->p_hh    = kf->r;
+    kf->p_hv    = 0.0f;
+    kf->p_vv    = kf->p_init;
+    kf->rejects = 0;
+    kf->started = true;
+}
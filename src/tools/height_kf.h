@@ -0,0 +1,45 @@
+/*
+ * height_kf.h
+ */
+
+#ifndef TOOLS_HEIGHT_KF_H_
+#define TOOLS_HEIGHT_KF_H_
+
+#include <stdbool.h>
+
+/* ----------------------------------------------------------
+ *
+ * two state Kalman filter, height h & vertical velocity v.
+ * the velocity follows a commanded climb rate with a first
+ * order lag tau:
+ *  h' = h + v * dt
+ *  v' = v + (v_cmd - v) * dt / tau
+ * a measurement whose innovation is beyond gate sigmas is an
+ * outlier & rejected, unless max_reject of them came in a row,
+ * then the filter is reset on it.
+ *
+ * --------------------------------------------------------*/
+struct height_kf {
+    float h;
+    float v;
+    float p_hh;
+    float p_hv;
+    float p_vv;
+
+    float tau;          /* units: s */
+    float q_h;          /* process noise density of h & v. */
+    float q_v;
+    float r;            /* measurement variance, units: m^2 */
+    float gate;         /* units: sigma */
+    float p_init;
+    unsigned char max_reject;
+    unsigned char rejects;
+    bool  started;
+};
+
+extern void height_kf_init(struct height_kf *kf, float tau, float q_h, float q_v, float r, float gate,
+                           unsigned char max_reject);
+extern void height_kf_predict(struct height_kf *kf, float v_cmd, float dt);
+extern bool height_kf_update(struct height_kf *kf, float z);
+
+#endif /* TOOLS_HEIGHT_KF_H_ */
@@ -0,0 +1,119 @@
+/*
+ * pid_autotune.c
+ */
+
+#include <math.h>
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "pid_autotune.h"
+
+#define AUTOTUNE_PI     3.14159265f
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void autotune_finish(struct pid_autotune *at);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void autotune_start(struct pid_autotune *at, float amp, float hyst, uint8_t cycles,
+                    uint32_t now_us, uint32_t timeout_ms)
+{
+    at->amp          = amp;
+    at->hyst         = hyst;
+    at->out          = amp;
+    at->e_max        = -INFINITY;
+    at->e_min        = INFINITY;
+    at->a_sum        = 0.0f;
+    at->tu_sum_us    = 0;
+    at->start_us     = now_us;
+    at->last_rise_us = now_us;
+    at->timeout_us   = timeout_ms * 1000UL;
+    at->rises        = 0;
+    at->cycles       = cycles ? cycles : 1;
+    at->ku           = 0.0f;
+    at->tu           = 0.0f;
+    at->state        = AUTOTUNE_RUNNING;
+}
+
+/* ----------------------------------------------------------
+ *
+ * called once per control period with error = setpoint -
+ * measurement, returns the relay output, 0 once finished.
+ *
+ * --------------------------------------------------------*/
+float autotune_update(struct pid_autotune *at, float error, uint32_t now_us)
+{
+    if (at->state != AUTOTUNE_RUNNING) return 0.0f;
+    if (now_us - at->start_us > at->timeout_us) {
+        at->state = AUTOTUNE_FAILED;
+        at->out = 0.0f;
+        return 0.0f;
+    }
+
+    if (error > at->e_max) at->e_max = error;
+    if (error < at->e_min) at->e_min = error;
+
+    if (at->out < 0.0f && error > at->hyst) {
+        /* one whole cycle since the last switch to +amp. */
+        at->out = at->amp;
+        if (at->rises >= 2) {
+            at->a_sum += (at->e_max - at->e_min) * 0.5f;
+            at->tu_sum_us += now_us - at->last_rise_us;
+        }
+        at->rises++;
+        at->last_rise_us = now_us;
+        at->e_max = -INFINITY;
+        at->e_min = INFINITY;
+        if (at->rises >= at->cycles + 2) autotune_finish(at);
+    } else if (at->out > 0.0f && error < -(at->hyst)) {
+        at->out = -(at->amp);
+    }
+    return at->out;
+}
+
+bool autotune_gains(const struct pid_autotune *at, autotune_rule_e rule, float *kp, float *ki, float *kd)
+{
+    float ti, td;
+
+    if (at->state != AUTOTUNE_DONE) return false;
+    switch (rule) {
+    case AUTOTUNE_RULE_TL:
+        *kp = at->ku / 2.2f;
+        ti  = at->tu * 2.2f;
+        td  = at->tu / 6.3f;
+        break;
+    case AUTOTUNE_RULE_NO_OVERSHOOT:
+        *kp = at->ku * 0.2f;
+        ti  = at->tu * 0.5f;
+        td  = at->tu / 3.0f;
+        break;
+    case AUTOTUNE_RULE_ZN:
+    default:
+        *kp = at->ku * 0.6f;
+        ti  = at->tu * 0.5f;
+        td  = at->tu * 0.125f;
+        break;
+    }
+    *ki = *kp / ti;
+    *kd = *kp * td;
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+static void autotune_finish(struct pid_autotune *at)
+{
+    float a = at->a_sum / (float)at->cycles;
+    float d = a * a - at->hyst * at->hyst;
+
+    at->out = 0.0f;
+    if (d <= 0.0f || at->tu_sum_us == 0) {
+        at->state = AUTOTUNE_FAILED;
+        return;
+    }
+    at->ku    = 4.0f * at->amp / (AUTOTUNE_PI * sqrtf(d));
+    at->tu    = (float)at->tu_sum_us * 1e-6f / (float)at->cycles;
+    at->state = AUTOTUNE_DONE;
+}
@@ -0,0 +1,60 @@
+/*
+ * pid_autotune.h
+ */
+
+#ifndef TOOLS_PID_AUTOTUNE_H_
+#define TOOLS_PID_AUTOTUNE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    AUTOTUNE_IDLE = 0,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED
+} autotune_state_e;
+
+/* tuning rules from the ultimate gain & period. */
+typedef enum {
+    AUTOTUNE_RULE_ZN = 0,           /* Ziegler-Nichols, fast, overshoots. */
+    AUTOTUNE_RULE_TL = 1,           /* Tyreus-Luyben, damped. */
+    AUTOTUNE_RULE_NO_OVERSHOOT = 2, /* Ziegler-Nichols without overshoot. */
+    AUTOTUNE_RULE_NUM
+} autotune_rule_e;
+
+/* ----------------------------------------------------------
+ *
+ * relay feedback (Astrom-Hagglund): the output is +-amp by the
+ * sign of the error, with hysteresis. the loop settles into a
+ * limit cycle, whose amplitude a & period tu give the ultimate
+ * gain ku = 4 * amp / (pi * sqrt(a^2 - hyst^2)). the first
+ * cycle is a transient and is not measured.
+ * the times are timestamp_us() values, only their unsigned
+ * differences are used so the counter may wrap.
+ *
+ * --------------------------------------------------------*/
+struct pid_autotune {
+    float    amp;
+    float    hyst;
+    float    out;
+    float    e_max;
+    float    e_min;
+    float    a_sum;
+    uint32_t tu_sum_us;
+    uint32_t start_us;
+    uint32_t last_rise_us;
+    uint32_t timeout_us;
+    uint8_t  rises;
+    uint8_t  cycles;        /* measured cycles wanted. */
+    float    ku;
+    float    tu;            /* units: s */
+    autotune_state_e state;
+};
+
+extern void autotune_start(struct pid_autotune *at, float amp, float hyst, uint8_t cycles,
+                           uint32_t now_us, uint32_t timeout_ms);
+extern float autotune_update(struct pid_autotune *at, float error, uint32_t now_us);
+extern bool autotune_gains(const struct pid_autotune *at, autotune_rule_e rule, float *kp, float *ki, float *kd);
+
+#endif /* TOOLS_PID_AUTOTUNE_H_ */
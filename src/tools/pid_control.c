@@ -5,6 +5,9 @@
  *      Author: Cotyledon
  */
 
+#include <stddef.h>
+#include <math.h>
+/*-----------------------------------------------------------*/
 /* User include files. */
 #include "pid_control.h"
 
@@ -32,16 +35,30 @@ void pid_init(struct pid_param *pp, struct pid_cfg *pc)
     pc->pid_out         = 0.0;
 }
 
+/* ----------------------------------------------------------
+ *
+ * legacy error based update, runs on pid2 with the error fed
+ * as a negative measurement against a zero setpoint, so the
+ * derivative of the measurement is the derivative of the error.
+ * the old results are kept: the deadband, the integral acting
+ * on the same step & only clamped, the reset on a sign change,
+ * and last_error & the derivative only moving while kd is set.
+ * so the integral is advanced here and pid2 runs with ki = 0.
+ *
+ * --------------------------------------------------------*/
 void pid_update(struct pid_param *pp, struct pid_cfg *pc)
 {
+    struct pid2_param p2;
+    struct pid2 c;
+    bool use_d = (pp->kd != 0) && (pp->dt != 0);
+
     if (pc->error < pc->error_min && pc->error > -(pc->error_min)) {
         pc->integrator = 0;
         return;
     }
     pc->proportion = pp->kp * pc->error;
 
-    // calculate integrator constrain in i_max.
-    if((pp->ki != 0) && (pp->dt != 0)) {
+    if ((pp->ki != 0) && (pp->dt != 0)) {
         pc->integrator += pp->ki * pc->error * pp->dt;
         if (pc->integrator < -(pp->i_max)) {
             pc->integrator = -(pp->i_max);
@@ -53,21 +70,184 @@ void pid_update(struct pid_param *pp, struct pid_cfg *pc)
     }
     if (pc->error * pc->last_error < 0) pc->integrator = 0;
 
-    // calculate instantaneous derivative.
-    if((pp->kd != 0) && (pp->dt != 0)) {
-        pc->derivative = pp->kd * (pc->error - pc->last_error) / pp->dt;
-        // discrete low pass filter, cuts out the
-        // high frequency noise that can drive the controller crazy.
-        pc->derivative = pc->last_derivative + pp->dt / (pp->d_lpf_alpha + pp->dt) * (pc->derivative - pc->last_derivative);
-        // update state
-        pc->last_error = pc->error;
-        pc->last_derivative = pc->derivative;
+    p2.kp          = pp->kp;
+    p2.ki          = 0.0f;
+    p2.kd          = use_d ? pp->kd : 0.0f;
+    p2.dt          = pp->dt;
+    p2.d_lpf_alpha = pp->d_lpf_alpha;
+    p2.b           = 1.0f;
+    p2.kaw         = 0.0f;
+    p2.i_max       = pp->i_max;
+    p2.out_max     = pp->out_max;
+    pid2_configure(&c, &p2);
+    if (!use_d) c.lpf = 0.0f;   /* holds the derivative. */
+    c.integrator   = pc->integrator;
+    c.derivative   = use_d ? pc->last_derivative : pc->derivative;
+    c.last_measure = -(pc->last_error);
+    c.started      = true;
+
+    pc->pid_out = pid2_update(&c, 0.0f, -(pc->error), 0.0f);
+    if (use_d) {
+        pc->derivative      = c.derivative;
+        pc->last_error      = pc->error;
+        pc->last_derivative = c.derivative;
     }
+}
+
+void pid2_param_init(struct pid2_param *pp)
+{
+    pp->kp          = DEFAULT_KP;
+    pp->ki          = DEFAULT_KI;
+    pp->kd          = DEFAULT_KD;
+    pp->dt          = 1.0 / (float)DEFAULT_PID_FREQ;
+    pp->d_lpf_alpha = DEFAULT_LPFITER;
+    pp->b           = 1.0f;
+    pp->kaw         = 0.0f;
+    pp->i_max       = DEFAULT_I_MAX;
+    pp->out_max     = DEFAULT_OUT_MAX;
+}
+
+/* ----------------------------------------------------------
+ *
+ * precomputes the coefficients, the state is kept, so gains
+ * & dt may be changed while the loop runs.
+ *
+ * --------------------------------------------------------*/
+void pid2_configure(struct pid2 *c, const struct pid2_param *pp)
+{
+    float kaw = pp->kaw;
+
+    if (kaw <= 0.0f) kaw = (pp->kp != 0.0f) ? pp->ki / pp->kp : 0.0f;
+    c->kp      = pp->kp;
+    c->kp_b    = pp->kp * pp->b;
+    c->ki_dt   = pp->ki * pp->dt;
+    c->kd_dt   = (pp->dt > 0.0f) ? pp->kd / pp->dt : 0.0f;
+    c->lpf     = (pp->dt > 0.0f) ? pp->dt / (pp->d_lpf_alpha + pp->dt) : 0.0f;
+    c->kaw_dt  = kaw * pp->dt;
+    c->i_max   = pp->i_max;
+    c->out_max = pp->out_max;
+}
+
+void pid2_reset(struct pid2 *c)
+{
+    c->integrator   = 0.0f;
+    c->derivative   = 0.0f;
+    c->last_measure = 0.0f;
+    c->out          = 0.0f;
+    c->started      = false;
+}
+
+float pid2_update(struct pid2 *c, float setpoint, float measure, float feedforward)
+{
+    float v, u;
+
+    if (!c->started) {
+        c->last_measure = measure;
+        c->started = true;
+    }
+
+    // derivative on measurement, low passed.
+    c->derivative += c->lpf * (c->kd_dt * (c->last_measure - measure) - c->derivative);
+    c->last_measure = measure;
+
+    v = c->kp_b * setpoint - c->kp * measure + c->integrator + c->derivative + feedforward;
+    u = v;
+    if (u > c->out_max) {
+        u = c->out_max;
+    } else if (u < -(c->out_max)) {
+        u = -(c->out_max);
+    }
+
+    // integrate, backing off by the part of the output that was cut.
+    c->integrator += c->ki_dt * (setpoint - measure) + c->kaw_dt * (u - v);
+    if (c->integrator > c->i_max) {
+        c->integrator = c->i_max;
+    } else if (c->integrator < -(c->i_max)) {
+        c->integrator = -(c->i_max);
+    }
+
+    c->out = u;
+    return u;
+}
+
+/* ----------------------------------------------------------
+ *
+ * num axes, all reset & with zero gains until configured.
+ *
+ * --------------------------------------------------------*/
+void pid_bank_init(struct pid_bank *bank, uint8_t num)
+{
+    struct pid2_param pp;
+
+    if (num > PID_BANK_MAX) num = PID_BANK_MAX;
+    bank->num = num;
+    pid2_param_init(&pp);
+    pp.kp = pp.ki = pp.kd = 0.0f;
+    for (uint8_t i = 0; i < PID_BANK_MAX; i++) {
+        pid_bank_configure(bank, i, &pp);
+        pid_bank_reset(bank, i);
+    }
+}
+
+void pid_bank_configure(struct pid_bank *bank, uint8_t axis, const struct pid2_param *pp)
+{
+    struct pid2 c;
+
+    pid2_configure(&c, pp);
+    bank->kp[axis]      = c.kp;
+    bank->kp_b[axis]    = c.kp_b;
+    bank->ki_dt[axis]   = c.ki_dt;
+    bank->kd_dt[axis]   = c.kd_dt;
+    bank->lpf[axis]     = c.lpf;
+    bank->kaw_dt[axis]  = c.kaw_dt;
+    bank->i_max[axis]   = c.i_max;
+    bank->out_max[axis] = c.out_max;
+}
+
+void pid_bank_reset(struct pid_bank *bank, uint8_t axis)
+{
+    bank->integrator[axis]   = 0.0f;
+    bank->derivative[axis]   = 0.0f;
+    bank->last_measure[axis] = 0.0f;
+    bank->out[axis]          = 0.0f;
+    bank->started &= (uint8_t)~(1u << axis);
+}
+
+/* ----------------------------------------------------------
+ *
+ * updates every axis, the outputs are left in bank->out.
+ * feedforward may be NULL.
+ *
+ * --------------------------------------------------------*/
+void pid_bank_update(struct pid_bank *bank, const float *setpoint, const float *measure, const float *feedforward)
+{
+    static const float no_feedforward[PID_BANK_MAX] = {0.0f};
+    uint8_t n = bank->num;
+    uint8_t all = (uint8_t)((1u << n) - 1);
+
+    if (feedforward == NULL) feedforward = no_feedforward;
+
+    // an axis starts from its first measurement, so there is no kick.
+    if (bank->started != all) {
+        for (uint8_t i = 0; i < n; i++) {
+            if (!(bank->started & (1u << i))) bank->last_measure[i] = measure[i];
+        }
+        bank->started = all;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        float y = measure[i];
+        float v, u;
+
+        bank->derivative[i] += bank->lpf[i] * (bank->kd_dt[i] * (bank->last_measure[i] - y) - bank->derivative[i]);
+        bank->last_measure[i] = y;
+
+        v = bank->kp_b[i] * setpoint[i] - bank->kp[i] * y + bank->integrator[i] + bank->derivative[i]
+            + feedforward[i];
+        u = fminf(fmaxf(v, -bank->out_max[i]), bank->out_max[i]);
 
-    pc->pid_out = pc->proportion + pc->integrator + pc->derivative;
-    if (pc->pid_out > pp->out_max) {
-        pc->pid_out = pp->out_max;
-    } else if (pc->pid_out < -(pp->out_max)) {
-        pc->pid_out = -(pp->out_max);
+        bank->integrator[i] = fminf(fmaxf(bank->integrator[i] + bank->ki_dt[i] * (setpoint[i] - y)
+                                          + bank->kaw_dt[i] * (u - v), -bank->i_max[i]), bank->i_max[i]);
+        bank->out[i] = u;
     }
 }
@@ -8,6 +8,9 @@
 #ifndef COMPONENTS_PID_CONTROL_H_
 #define COMPONENTS_PID_CONTROL_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #define DEFAULT_KP          1.0f
 #define DEFAULT_KI          0.5f
 #define DEFAULT_KD          0.01f
@@ -48,7 +51,84 @@ struct pid_cfg {
     float pid_out;
 };
 
+/* ----------------------------------------------------------
+ *
+ * pid2, works on setpoint & measurement instead of the error:
+ *  u = kp * (b * sp - y) + i - kd * dy/dt (low passed) + ff
+ * the derivative is taken on the measurement, so setpoint jumps
+ * give no kick. the integrator is limited to i_max and is
+ * backed off by kaw * (u_clamped - u) when the output saturates.
+ * kaw <= 0 selects ki / kp.
+ *
+ * --------------------------------------------------------*/
+struct pid2_param {
+    float kp;
+    float ki;
+    float kd;
+    float dt;           //unit:s
+    float d_lpf_alpha;  //derivative low pass time constant, unit:s
+    float b;            //setpoint weight of the proportional term, 0..1
+    float kaw;          //back-calculation gain, unit:1/s
+    float i_max;
+    float out_max;
+};
+
+/* coefficients are computed by pid2_configure(), the update is
+ * multiply-add only. */
+struct pid2 {
+    float kp;
+    float kp_b;
+    float ki_dt;
+    float kd_dt;
+    float lpf;
+    float kaw_dt;
+    float i_max;
+    float out_max;
+
+    float integrator;
+    float derivative;
+    float last_measure;
+    float out;
+    bool  started;
+};
+
+/* ----------------------------------------------------------
+ *
+ * PID_BANK_MAX pid2 controllers stored as arrays of each field,
+ * all axes are updated in one pass without branches, so the
+ * loop can be pipelined. same control law as pid2.
+ *
+ * --------------------------------------------------------*/
+#define PID_BANK_MAX    4
+
+struct pid_bank {
+    uint8_t num;
+    uint8_t started;    /* bit per axis. */
+
+    float kp[PID_BANK_MAX];
+    float kp_b[PID_BANK_MAX];
+    float ki_dt[PID_BANK_MAX];
+    float kd_dt[PID_BANK_MAX];
+    float lpf[PID_BANK_MAX];
+    float kaw_dt[PID_BANK_MAX];
+    float i_max[PID_BANK_MAX];
+    float out_max[PID_BANK_MAX];
+
+    float integrator[PID_BANK_MAX];
+    float derivative[PID_BANK_MAX];
+    float last_measure[PID_BANK_MAX];
+    float out[PID_BANK_MAX];
+};
+
 extern void pid_init(struct pid_param *pp, struct pid_cfg *pc);
 extern void pid_update(struct pid_param *pp, struct pid_cfg *pc);
+extern void pid2_param_init(struct pid2_param *pp);
+extern void pid2_configure(struct pid2 *c, const struct pid2_param *pp);
+extern void pid2_reset(struct pid2 *c);
+extern float pid2_update(struct pid2 *c, float setpoint, float measure, float feedforward);
+extern void pid_bank_init(struct pid_bank *bank, uint8_t num);
+extern void pid_bank_configure(struct pid_bank *bank, uint8_t axis, const struct pid2_param *pp);
+extern void pid_bank_reset(struct pid_bank *bank, uint8_t axis);
+extern void pid_bank_update(struct pid_bank *bank, const float *setpoint, const float *measure, const float *feedforward);
 
 #endif /* COMPONENTS_PID_CONTROL_H_ */
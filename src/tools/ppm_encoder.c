@@ -7,52 +7,109 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform.h"
 #include "r_cg_tmr.h"
 
 #include "ppm_encoder.h"
+#include "sbus_encoder.h"
+#include "timestamp.h"
+#include "ppm_trace.h"
 
 
 ////unit: us
 //#define PPM_ENCODER_RESOLUTION 1
-//unit: us
-#define PPM_ENCODER_TOTAL_CH_VAL 20000
-#define PPM_ENCODER_NEG_CH_VAL 500
-//calculate array value
-#define CAL_ARR(ch_val) (ch_val * ppm_period_us)
 //gpio configure
 #define PPM_GPIO_HIGH   true
 #define PPM_GPIO_LOW    false
-//timer configure:TMR2 input clock 5MHz
-#define TMR0_CLK    (5000000)
+//TMR0 access, a host build can define these to record the output instead.
+#ifndef PPM_HW_SET_CMP
+#define PPM_HW_SET_CMP(cnt)     U_TMR0_SetCMPA(cnt)
+#endif
+#ifndef PPM_HW_SET_OUT
+#define PPM_HW_SET_OUT(level)   U_TMR0_SetOUTA(level)
+#endif
 
 
-ppm_data_t ppm_data; //for send_ppm().
+ppm_data_t ppm_data; //the merged channels, last set.
 
-typedef enum
-{
-    PPM_STATE_CH_NEG,
-    PPM_STATE_CH_POS,
-    PPM_STATE_IDLE_NEG,
-    PPM_STATE_IDLE_POS,
-    PPM_STATE_STOP,
-}ppm_state_e;
-
-//gpio cache
-//static bool ppm_gpio_next_val;
-
-//timer period per us, this will be caclulated when initialization
-static uint32_t ppm_period_us = 1;
+//values & claimed channels of each owner.
+static uint16_t ppm_owner_val[PPM_OWNER_NUM][PPM_ENCODER_CHANNEL_NUM];
+static uint32_t ppm_owner_mask[PPM_OWNER_NUM];
 
-//ppm data buffer,  used to save user setting
-#define PPM_DATA_BUF_NUM 2
-static ppm_data_t ppm_data_buf[PPM_DATA_BUF_NUM];
-static uint32_t ppm_data_buf_index;
-
-//ppm data shadow buffer,  used to encode ppm
-static ppm_data_t ppm_data_shadow;
-static ppm_state_e ppm_shadow_state;
-static uint32_t ppm_shadow_ch_idx;
+/* ----------------------------------------------------------
+ *
+ * one frame compiled for TMR0: each compare match sets the
+ * output level of the next match and how long until then, so
+ * the ISR only steps through the table.
+ *
+ * --------------------------------------------------------*/
+struct ppm_edge {
+    uint16_t cmp;       /* TMR0 counts */
+    bool     level;     /* output at the end of cmp */
+};
+
+struct ppm_frame {
+    struct ppm_edge edge[PPM_EDGE_NUM];
+    uint32_t seq;
+    uint32_t t_us;      //timestamp_us() of the set
+};
+
+/* ----------------------------------------------------------
+ *
+ * triple buffer: the writer owns one frame, the ISR another,
+ * and the third is the latest one published. both sides swap
+ * their own index with ppm_tb_latest by xchg, so the ISR can
+ * never latch a frame that is still being written.
+ *
+ * --------------------------------------------------------*/
+#define PPM_DATA_BUF_NUM 3
+#define PPM_TB_NEW       0x04    //ppm_tb_latest holds a frame not latched yet
+#define PPM_TB_IDX       0x03
+static struct ppm_frame ppm_frame_buf[PPM_DATA_BUF_NUM];
+static signed long ppm_tb_write;
+static signed long ppm_tb_latest;
+static signed long ppm_tb_read;
+static const struct ppm_frame *ppm_frame_cur;
+static uint32_t ppm_edge_idx;
+
+//seq of the last frame set, & of the last frame sent in full.
+static uint32_t ppm_seq_set;
+static volatile uint32_t ppm_seq_sent;
+//frames sent in full since the ISR latched ppm_seq_sent.
+static volatile uint32_t ppm_since_set;
+
+/* ----------------------------------------------------------
+ *
+ * frame start event: TMR0 is the fast interrupt & can not use
+ * the RTOS, so at each latch it starts the CMT2 one-shot,
+ * whose interrupt notifies the subscribed tasks after the
+ * phase offset.
+ *
+ * --------------------------------------------------------*/
+#define PPM_EVENT_PRIORITY      5
+#define PPM_EVENT_US_TO_CNT(us) ((us) * (configPERIPHERAL_CLOCK_HZ / 32 / 1000) / 1000)
+#define PPM_EVENT_OFFSET_MIN    100
+static TaskHandle_t ppm_frame_subscriber[PPM_FRAME_SUBSCRIBER_MAX];
+static uint32_t ppm_event_offset_us = PPM_FRAME_EVENT_OFFSET_US;
+static struct ppm_latency ppm_latency;
+static uint32_t ppm_latency_seq;
+
+/* ----------------------------------------------------------
+ *
+ * failsafe fast path: a frame compiled ahead, which the ISR
+ * switches to at the next channel boundary once triggered,
+ * & keeps sending until cleared. the channels before the
+ * boundary are from the frame that was being sent.
+ *
+ * --------------------------------------------------------*/
+static struct ppm_frame ppm_frame_failsafe;
+static volatile bool ppm_failsafe_on = false;
+//CMT0 counts at the trigger & at the switch.
+static volatile uint16_t ppm_failsafe_cnt_trigger;
+static volatile uint16_t ppm_failsafe_cnt_switch;
+static volatile bool ppm_failsafe_switched = false;
 
 static bool first_time = true;
 
@@ -64,9 +121,9 @@ static void ppm_timer_config(void);
 static void ppm_data_calculate_idle(ppm_data_t *ppm_data);
 static void ppm_data_set_default(ppm_data_t *ppm_data);
 static void ppm_data_buf_init(void);
-static void ppm_data_shadow_init(void);
-static void ppm_data_shadow_update(void);
-static bool ppm_data_shadow_one_step(void);
+static void ppm_frame_compile(const ppm_data_t *ppm_data, struct ppm_frame *frame);
+static uint32_t ppm_channel_merge(void);
+static void ppm_event_timer_config(void);
 
 void set_ppm_channel(ppm_data_t *ppm_data, uint16_t* channel)
 {
@@ -80,11 +137,24 @@ void set_ppm_channel(ppm_data_t *ppm_data, uint16_t* channel)
 
 void ppm_encoder_init(void)
 {
+    uint32_t i;
+
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
+    {
+        ppm_owner_val[PPM_OWNER_BASE][i] = PPM_ENCODER_DEFFAULT_CH_VAL;
+    }
+    //send_ppm() does not write these.
+    ppm_owner_val[PPM_OWNER_BASE][5] = channel_val_MIN;
+    ppm_owner_val[PPM_OWNER_BASE][TUNE_CHANNEL] = channel_val_MIN;
+    ppm_owner_mask[PPM_OWNER_BASE] = PPM_CH_ALL;
     ppm_data_buf_init();
-    ppm_data_shadow_init();
+#if PPM_OUTPUT_SBUS
+    sbus_encoder_init();
+#else
     ppm_gpio_init();
     //delay_ms(500);
     ppm_timer_config();
+#endif
     send_ppm(channel_val_MID,channel_val_MID,channel_val_MIN,channel_val_MID,channel_val_MIN,channel_val_MAX);
 }
 
@@ -96,12 +166,12 @@ static void ppm_gpio_init(void)
 
 static void ppm_gpio_negative(void)
 {
-    U_TMR0_SetOUTA(PPM_GPIO_LOW);
+    PPM_HW_SET_OUT(PPM_GPIO_LOW);
 }
 
 static void ppm_gpio_positive(void)
 {
-    U_TMR0_SetOUTA(PPM_GPIO_HIGH);
+    PPM_HW_SET_OUT(PPM_GPIO_HIGH);
 }
 
 static void ppm_gpio_set_next(bool is_pos)
@@ -128,13 +198,12 @@ static void ppm_gpio_set_next(bool is_pos)
 
 static void ppm_timer_config(void)
 {
-    ppm_period_us = TMR0_CLK / 1000000;
-
     //
     // Configure the two 32-bit periodic timers.
     //
 
-    U_TMR0_SetCMPA(CAL_ARR(PPM_ENCODER_NEG_CH_VAL));
+    PPM_HW_SET_CMP(PPM_ENCODER_NEG_CH_VAL * PPM_CNT_PER_US);
+    ppm_event_timer_config();
 
     //
     // Enable the timers.
@@ -144,45 +213,383 @@ static void ppm_timer_config(void)
 
 //*****************************************************************************
 //
-// The interrupt handler for the first timer interrupt.
+// The interrupt handler for the first timer interrupt. sets up the next
+// edge of the compiled frame, and latches the newest frame at the end.
 //
 //*****************************************************************************
 void TMR0_IntHandler(void)
 {
+    const struct ppm_edge *e;
+#if PPM_TRACE_ENABLE
+    uint16_t t_in = CMT0.CMCNT;
+    uint32_t idx;
+#endif
+
     if(first_time)
     {
         first_time = false;
         return;
     }
 
-    if(ppm_data_shadow_one_step())
+    //even entries start a channel, the one before is complete.
+    if(ppm_failsafe_on && ppm_frame_cur != &ppm_frame_failsafe && !(ppm_edge_idx & 1))
     {
-        ppm_data_shadow_update();
+        ppm_frame_cur = &ppm_frame_failsafe;
+        ppm_failsafe_cnt_switch = CMT0.CMCNT;
+        ppm_failsafe_switched = true;
     }
+
+    e = &ppm_frame_cur->edge[ppm_edge_idx];
+    ppm_gpio_set_next(e->level);
+    PPM_HW_SET_CMP(e->cmp);
+#if PPM_TRACE_ENABLE
+    idx = ppm_edge_idx;
+#endif
+    if(++ppm_edge_idx >= PPM_EDGE_NUM)
+    {
+        ppm_edge_idx = 0;
+        if(ppm_frame_cur != &ppm_frame_failsafe && ppm_frame_cur->seq != ppm_seq_sent)
+        {
+            ppm_seq_sent = ppm_frame_cur->seq;
+            ppm_since_set = 0;
+        }
+        ppm_since_set++;
+        if(ppm_tb_latest & PPM_TB_NEW)
+        {
+            xchg(&ppm_tb_read, &ppm_tb_latest);
+            ppm_tb_read &= PPM_TB_IDX;
+        }
+        if(!ppm_failsafe_on)
+        {
+            ppm_frame_cur = ppm_frame_buf + ppm_tb_read;
+        }
+        CMT2.CMCNT = 0;
+        CMT.CMSTR1.BIT.STR2 = 1;
+    }
+#if PPM_TRACE_ENABLE
+    //CMT0 is cleared each tick, count across it.
+    ppm_trace_edge(e->cmp, e->level, (uint8_t)idx,
+                   (uint16_t)((CMT0.CMCNT + CMT0.CMCOR + 1UL - t_in) % (CMT0.CMCOR + 1UL)));
+#endif
+}
+
+/* ----------------------------------------------------------
+ *
+ * CMT2, the offset after a latch. measures how long the frame
+ * latched waited since it was set, once for each new frame.
+ *
+ * --------------------------------------------------------*/
+#pragma interrupt ppm_frame_event_interrupt(vect=VECT(CMT2,CMI2))
+static void ppm_frame_event_interrupt(void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    const struct ppm_frame *frame = ppm_frame_cur;
+    uint32_t latency;
+    int i;
+
+    CMT.CMSTR1.BIT.STR2 = 0;
+    ppm_latency.frames++;
+    if(frame != &ppm_frame_failsafe && frame->seq != ppm_latency_seq)
+    {
+        ppm_latency_seq = frame->seq;
+        latency = timestamp_us() - ppm_event_offset_us - frame->t_us;
+        ppm_latency.last_us = latency;
+        if(latency > ppm_latency.max_us) ppm_latency.max_us = latency;
+        ppm_latency.avg_us += ((int32_t)latency - (int32_t)ppm_latency.avg_us) / 8;
+        ppm_latency.commands++;
+    }
+
+    for(i = 0; i < PPM_FRAME_SUBSCRIBER_MAX; i++)
+    {
+        if(ppm_frame_subscriber[i] != NULL)
+            vTaskNotifyGiveFromISR(ppm_frame_subscriber[i], &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* ----------------------------------------------------------
+ *
+ * compiles the failsafe channels, values out of range keep
+ * the default. done ahead so the trigger has nothing to do.
+ * NOTE:not while the failsafe is on.
+ *
+ * --------------------------------------------------------*/
+void ppm_failsafe_preload(const uint16_t *ch_val)
+{
+    ppm_data_t data;
+
+    ppm_data_set_default(&data);
+    set_ppm_channel(&data, (uint16_t *)ch_val);
+    ppm_data_calculate_idle(&data);
+    ppm_frame_compile(&data, &ppm_frame_failsafe);
+    ppm_frame_failsafe.seq = 0;
+}
+
+/* ----------------------------------------------------------
+ *
+ * the output goes to the failsafe frame at the next channel
+ * boundary, without the RTOS. callable from any interrupt &
+ * from tasks, it only sets a flag.
+ *
+ * --------------------------------------------------------*/
+void ppm_failsafe_trigger(void)
+{
+    if(ppm_failsafe_on) return;
+    ppm_failsafe_cnt_trigger = CMT0.CMCNT;
+    ppm_failsafe_switched = false;
+    ppm_failsafe_on = true;
+}
+
+//back to the frames set, from the next frame end.
+void ppm_failsafe_clear(void)
+{
+    ppm_failsafe_on = false;
+}
+
+bool ppm_failsafe_active(void)
+{
+    return ppm_failsafe_on;
 }
 
+/* ----------------------------------------------------------
+ *
+ * trigger to switch of the last failsafe, units: us. 0 until
+ * the ISR has switched. from CMT0 counts, so only right below
+ * one tick (10ms), which the channel boundary always is.
+ *
+ * --------------------------------------------------------*/
+uint32_t ppm_failsafe_latency_us(void)
+{
+    uint32_t period = CMT0.CMCOR + 1UL;
+
+    if(!ppm_failsafe_switched) return 0;
+    return ((ppm_failsafe_cnt_switch + period - ppm_failsafe_cnt_trigger) % period)
+           / TIMESTAMP_CNT_PER_US;
+}
 
-void ppm_encoder_set_data(ppm_data_t *ppm_data)
+/* ----------------------------------------------------------
+ *
+ * the task gets a notification (xTaskNotifyGive) the phase
+ * offset after each frame latch. the default offset wakes it
+ * just before the next latch, so what it sets goes out with
+ * the least wait.
+ * NOTE:unsubscribe a task before deleting it. no events with
+ * PPM_OUTPUT_SBUS.
+ *
+ * --------------------------------------------------------*/
+void ppm_frame_subscribe(TaskHandle_t task)
 {
-    memcpy(ppm_data_buf + ppm_data_buf_index, ppm_data, sizeof(ppm_data_t));
-    ppm_data_calculate_idle(ppm_data_buf + ppm_data_buf_index);
-    ppm_data_buf_index++;
-    if(ppm_data_buf_index >= PPM_DATA_BUF_NUM)
+    int i;
+
+    taskENTER_CRITICAL();
+    for(i = 0; i < PPM_FRAME_SUBSCRIBER_MAX; i++)
     {
-        ppm_data_buf_index = 0;
+        if(ppm_frame_subscriber[i] == task) break;
     }
+    if(i == PPM_FRAME_SUBSCRIBER_MAX)
+    {
+        for(i = 0; i < PPM_FRAME_SUBSCRIBER_MAX; i++)
+        {
+            if(ppm_frame_subscriber[i] == NULL)
+            {
+                ppm_frame_subscriber[i] = task;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+    configASSERT(i < PPM_FRAME_SUBSCRIBER_MAX);
+}
+
+void ppm_frame_unsubscribe(TaskHandle_t task)
+{
+    int i;
+
+    taskENTER_CRITICAL();
+    for(i = 0; i < PPM_FRAME_SUBSCRIBER_MAX; i++)
+    {
+        if(ppm_frame_subscriber[i] == task) ppm_frame_subscriber[i] = NULL;
+    }
+    taskEXIT_CRITICAL();
+}
+
+//the phase offset from the latch, units: us
+void ppm_frame_event_offset(uint32_t offset_us)
+{
+    if(offset_us < PPM_EVENT_OFFSET_MIN) offset_us = PPM_EVENT_OFFSET_MIN;
+    if(offset_us > PPM_ENCODER_TOTAL_CH_VAL - PPM_EVENT_OFFSET_MIN)
+        offset_us = PPM_ENCODER_TOTAL_CH_VAL - PPM_EVENT_OFFSET_MIN;
+    taskENTER_CRITICAL();
+    ppm_event_offset_us = offset_us;
+    CMT2.CMCOR = (unsigned short)(PPM_EVENT_US_TO_CNT(offset_us) - 1);
+    taskEXIT_CRITICAL();
 }
 
+void ppm_latency_read(struct ppm_latency *lat)
+{
+    taskENTER_CRITICAL();
+    *lat = ppm_latency;
+    taskEXIT_CRITICAL();
+}
+
+
+/* ----------------------------------------------------------
+ *
+ * publishes a frame, the ISR latches it at the next frame
+ * end. returns its sequence number.
+ * NOTE:one writer at a time.
+ *
+ * --------------------------------------------------------*/
+uint32_t ppm_encoder_set_data(ppm_data_t *ppm_data)
+{
+    struct ppm_frame *frame = ppm_frame_buf + ppm_tb_write;
+
+    ppm_data_calculate_idle(ppm_data);
+    ppm_frame_compile(ppm_data, frame);
+    frame->seq = ++ppm_seq_set;
+    frame->t_us = timestamp_us();
+    ppm_tb_write |= PPM_TB_NEW;
+    xchg(&ppm_tb_write, &ppm_tb_latest);
+    ppm_tb_write &= PPM_TB_IDX;
+    return frame->seq;
+}
+
+/* ----------------------------------------------------------
+ *
+ * true once the frame of seq, or a later one, has been sent
+ * in full to the flight controller.
+ *
+ * --------------------------------------------------------*/
+bool ppm_frame_sent(uint32_t seq)
+{
+#if PPM_OUTPUT_SBUS
+    return sbus_frame_sent(seq);
+#else
+    return (int32_t)(ppm_seq_sent - seq) >= 0;
+#endif
+}
+
+/* ----------------------------------------------------------
+ *
+ * frames sent in full with the data of the last set, 0 while
+ * that data has not reached the output yet.
+ *
+ * --------------------------------------------------------*/
+uint32_t ppm_frames_since_set(void)
+{
+#if PPM_OUTPUT_SBUS
+    return sbus_frames_since_set();
+#else
+    uint32_t seq, n;
+
+    //the ISR can not be masked, read again if it ran in between.
+    do
+    {
+        seq = ppm_seq_sent;
+        n = ppm_since_set;
+    } while(seq != ppm_seq_sent);
+
+    return seq == ppm_seq_set ? n : 0;
+#endif
+}
+
+/* ----------------------------------------------------------
+ *
+ * the owner takes the channels in mask, & holds them until it
+ * releases them. they start with the values sent at present.
+ *
+ * --------------------------------------------------------*/
+void ppm_channel_claim(ppm_owner_e owner, uint32_t mask)
+{
+    uint32_t i;
+
+    taskENTER_CRITICAL();
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
+    {
+        if((mask & PPM_CH(i)) && !(ppm_owner_mask[owner] & PPM_CH(i)))
+            ppm_owner_val[owner][i] = ppm_data.ch_val[i];
+    }
+    ppm_owner_mask[owner] |= mask & PPM_CH_ALL;
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * gives the channels back. the base owner takes over the
+ * values released, so nothing moves until it writes them.
+ * the base owner can not release.
+ *
+ * --------------------------------------------------------*/
+void ppm_channel_release(ppm_owner_e owner, uint32_t mask)
+{
+    uint32_t i;
+
+    if(owner == PPM_OWNER_BASE) return;
+    taskENTER_CRITICAL();
+    mask &= ppm_owner_mask[owner];
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
+    {
+        if(mask & PPM_CH(i))
+            ppm_owner_val[PPM_OWNER_BASE][i] = ppm_owner_val[owner][i];
+    }
+    ppm_owner_mask[owner] &= ~mask;
+    ppm_channel_merge();
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * writes ch_val[ch] for the channels in mask the owner has
+ * claimed, values out of range are ignored. the channels are
+ * merged by owner & published as one frame, the ISR latches
+ * the latest at each frame end. returns its sequence number.
+ *
+ * --------------------------------------------------------*/
+uint32_t ppm_channel_update(ppm_owner_e owner, uint32_t mask, const uint16_t *ch_val)
+{
+    uint32_t i, seq;
+
+    taskENTER_CRITICAL();
+    mask &= ppm_owner_mask[owner];
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
+    {
+        if((mask & PPM_CH(i)) && ch_val[i] >= channel_val_MIN && ch_val[i] <= channel_val_MAX)
+            ppm_owner_val[owner][i] = ch_val[i];
+    }
+    seq = ppm_channel_merge();
+    taskEXIT_CRITICAL();
+
+    return seq;
+}
+
+/* ----------------------------------------------------------
+ *
+ * writes all six channels it is given to the base owner, to
+ * set a few of them use ppm_channel_update() with a mask.
+ * a value out of range is ignored like there.
+ *
+ * --------------------------------------------------------*/
 void send_ppm(uint16_t channel_roll ,uint16_t channel_pitch ,uint16_t channel_throttle ,
                         uint16_t channel_yaw ,uint16_t channel_mode ,uint16_t channel_emergency)
 {
-    uint16_t channel_temp[PPM_ENCODER_CHANNEL_NUM] =
-            {channel_roll,channel_pitch,channel_throttle,channel_yaw,channel_mode,channel_val_MIN,channel_val_MIN,channel_emergency};
-    set_ppm_channel(&ppm_data,channel_temp);
-    ppm_encoder_set_data(&ppm_data);
+    uint16_t channel_temp[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    channel_temp[ROLL_CHANNEL] = channel_roll;
+    channel_temp[PITCH_CHANNEL] = channel_pitch;
+    channel_temp[THROTTLE_CHANNEL] = channel_throttle;
+    channel_temp[YAW_CHANNEL] = channel_yaw;
+    channel_temp[MODE_CHANNEL] = channel_mode;
+    channel_temp[EMERGENCY_CHANNEL] = channel_emergency;
+    ppm_channel_update(PPM_OWNER_BASE, SEND_PPM_CH, channel_temp);
     return;
 }
 
+//the value last set, after the owners are merged.
+uint16_t ppm_channel_get(channel_name_e ch)
+{
+    return ppm_data.ch_val[ch];
+}
+
 static void ppm_data_calculate_idle(ppm_data_t *ppm_data)
 {
     uint32_t j;
@@ -210,109 +617,104 @@ static void ppm_data_set_default(ppm_data_t *ppm_data)
 static void ppm_data_buf_init(void)
 {
     uint32_t i;
-    ppm_data_buf_index = 0;
+    ppm_data_t def;
+
+    ppm_data_set_default(&def);
+    ppm_frame_compile(&def, &ppm_frame_failsafe);
+    ppm_frame_failsafe.seq = 0;
     for(i = 0; i < PPM_DATA_BUF_NUM; i++)
     {
-        ppm_data_set_default(ppm_data_buf + i);
+        ppm_frame_compile(&def, ppm_frame_buf + i);
+        ppm_frame_buf[i].seq = 0;
     }
+    ppm_tb_read = 0;
+    ppm_tb_latest = 1;
+    ppm_tb_write = 2;
+    ppm_frame_cur = ppm_frame_buf + ppm_tb_read;
+    ppm_edge_idx = 0;
+    ppm_seq_set = 0;
+    ppm_seq_sent = 0;
+    ppm_since_set = 0;
 }
 
-static void ppm_data_shadow_init(void)
-{
-    //ppm_data_set_default(&ppm_data_shadow);
-    //ppm_shadow_state = PPM_STATE_CH_NEG;
-    //ppm_shadow_ch_idx = 0;
-    ppm_data_shadow_update();
-}
-
-static void ppm_data_shadow_update(void)
+/* ----------------------------------------------------------
+ *
+ * each channel takes the value of its highest owner.
+ * NOTE:called in a critical section, which makes it the only
+ * writer of the triple buffer.
+ *
+ * --------------------------------------------------------*/
+static uint32_t ppm_channel_merge(void)
 {
     uint32_t i;
-    for(i = 0; i < PPM_DATA_BUF_NUM; i++)
+    int o;
+
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
     {
-        if(i != ppm_data_buf_index)
+        for(o = PPM_OWNER_NUM - 1; o > PPM_OWNER_BASE; o--)
         {
-            memcpy(&ppm_data_shadow, ppm_data_buf + i, sizeof(ppm_data_t));
-            break;
+            if(ppm_owner_mask[o] & PPM_CH(i)) break;
         }
+        ppm_data.ch_val[i] = ppm_owner_val[o][i];
     }
-
-    if(i == PPM_DATA_BUF_NUM)
+#if PPM_OUTPUT_SBUS
     {
-        //impossible
-        ppm_data_set_default(&ppm_data_shadow);
-    }
-    ppm_shadow_state = PPM_STATE_CH_NEG;
-    ppm_shadow_ch_idx = 0;
-}
-
-
-static void handle_negative(void)
-{
-    //ppm_gpio_negative();
-    ppm_gpio_set_next(false);
-    U_TMR0_SetCMPA(CAL_ARR(PPM_ENCODER_NEG_CH_VAL));
-    ppm_shadow_state = PPM_STATE_CH_POS;
+        uint16_t pulse_us[PPM_ENCODER_CHANNEL_NUM];
 
-}
-
-static void handle_positive(void)
-{
-    //ppm_gpio_positive();
-    ppm_gpio_set_next(true);
-    U_TMR0_SetCMPA(CAL_ARR(ppm_data_shadow.ch_val[ppm_shadow_ch_idx]));
-    ppm_shadow_ch_idx++;
-    if(ppm_shadow_ch_idx >= PPM_ENCODER_CHANNEL_NUM)
-    {
-        ppm_shadow_state = PPM_STATE_IDLE_NEG;
-    }
-    else
-    {
-        ppm_shadow_state = PPM_STATE_CH_NEG;
+        //the pulse is the low pulse & the high level.
+        for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
+        {
+            pulse_us[i] = ppm_data.ch_val[i] + PPM_ENCODER_NEG_CH_VAL;
+        }
+        return sbus_encoder_set(pulse_us, PPM_ENCODER_CHANNEL_NUM);
     }
-
+#else
+    return ppm_encoder_set_data(&ppm_data);
+#endif
 }
 
-static void handle_idle_neg(void)
+static void ppm_event_timer_config(void)
 {
-    //ppm_gpio_negative();
-    ppm_gpio_set_next(false);
-    U_TMR0_SetCMPA(CAL_ARR(PPM_ENCODER_NEG_CH_VAL));
-    ppm_shadow_state = PPM_STATE_IDLE_POS;
+    const uint32_t ulEnableRegisterWrite = 0xA50BUL, ulDisableRegisterWrite = 0xA500UL;
+
+    SYSTEM.PRCR.WORD = ulEnableRegisterWrite;
+    MSTP(CMT2) = 0;
+    SYSTEM.PRCR.WORD = ulDisableRegisterWrite;
+
+    //PCLK/32, interrupt on compare match, started by each latch.
+    CMT.CMSTR1.BIT.STR2 = 0;
+    CMT2.CMCR.BIT.CKS = 1;
+    CMT2.CMCR.BIT.CMIE = 1;
+    CMT2.CMCOR = (unsigned short)(PPM_EVENT_US_TO_CNT(ppm_event_offset_us) - 1);
+    CMT2.CMCNT = 0;
+    IR(CMT2, CMI2) = 0;
+    IPR(CMT2, CMI2) = PPM_EVENT_PRIORITY;
+    IEN(CMT2, CMI2) = 1;
 }
 
-static void handle_idle_pos(void)
-{
-    //ppm_gpio_positive();
-    ppm_gpio_set_next(true);
-    U_TMR0_SetCMPA(CAL_ARR(ppm_data_shadow.idle_val));
-}
-
-
-static bool ppm_data_shadow_one_step(void)
+/* ----------------------------------------------------------
+ *
+ * the frame starts where the old state machine did: the low
+ * pulse before channel 0, and ends with the idle high level.
+ *
+ * --------------------------------------------------------*/
+static void ppm_frame_compile(const ppm_data_t *ppm_data, struct ppm_frame *frame)
 {
-    bool should_update = false;
+    struct ppm_edge *e = frame->edge;
+    uint32_t i;
 
-    switch(ppm_shadow_state)
+    for(i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++)
     {
-        case PPM_STATE_CH_NEG:
-            handle_negative();
-            break;
-        case PPM_STATE_CH_POS:
-            handle_positive();
-            break;
-        case PPM_STATE_IDLE_NEG:
-            handle_idle_neg();
-            break;
-        case PPM_STATE_IDLE_POS:
-            handle_idle_pos();
-            //ppm_shadow_state = PPM_STATE_STOP;
-            should_update = true;
-            break;
-        default:
-            //impossible
-            break;
+        e->cmp = PPM_ENCODER_NEG_CH_VAL * PPM_CNT_PER_US;
+        e->level = PPM_GPIO_LOW;
+        e++;
+        e->cmp = ppm_data->ch_val[i] * PPM_CNT_PER_US;
+        e->level = PPM_GPIO_HIGH;
+        e++;
     }
-
-    return should_update;
+    e->cmp = PPM_ENCODER_NEG_CH_VAL * PPM_CNT_PER_US;
+    e->level = PPM_GPIO_LOW;
+    e++;
+    e->cmp = ppm_data->idle_val * PPM_CNT_PER_US;
+    e->level = PPM_GPIO_HIGH;
 }
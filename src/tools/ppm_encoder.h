@@ -9,8 +9,26 @@
 #define COMPONENTS_PPM_ENCODER_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
 
 #define PPM_ENCODER_CHANNEL_NUM 8
+//unit: us
+#define PPM_ENCODER_TOTAL_CH_VAL 20000
+#define PPM_ENCODER_NEG_CH_VAL 500
+//timer configure:TMR0 input clock 5MHz
+#define TMR0_CLK    (5000000)
+//timer counts per us
+#define PPM_CNT_PER_US  (TMR0_CLK / 1000000)
+//a low pulse & a high level for each channel, then for the idle time.
+#define PPM_EDGE_NUM    (PPM_ENCODER_CHANNEL_NUM * 2 + 2)
+/* 1 sends the channels as SBUS on SCI5 instead of PPM on TMR0,
+ * see sbus_encoder.h. the car link on SCI5 is then off. */
+#define PPM_OUTPUT_SBUS 0
+#define PPM_FRAME_SUBSCRIBER_MAX    2
+/* the frame event this long after the latch, 2ms before the next. units: us */
+#define PPM_FRAME_EVENT_OFFSET_US   18000
 #define PPM_ENCODER_DEFFAULT_CH_VAL 1021
 #define PPM_USED_CHANN3EL_NUM 6
 #define channel_val_MAX 1451
@@ -27,8 +45,31 @@ typedef enum
     YAW_CHANNEL = 3,
     MODE_CHANNEL = 4,
     TUNE_CHANNEL = 6,
+    EMERGENCY_CHANNEL = 7,
 }channel_name_e;
 
+/* ----------------------------------------------------------
+ *
+ * channel owners, a higher one preempts the lower ones on the
+ * channels both have claimed. the base owner holds all the
+ * channels, send_ppm() writes six of them.
+ *
+ * --------------------------------------------------------*/
+typedef enum
+{
+    PPM_OWNER_BASE = 0,
+    PPM_OWNER_POS,
+    PPM_OWNER_ALT,
+    PPM_OWNER_FAILSAFE,
+    PPM_OWNER_NUM
+}ppm_owner_e;
+
+#define PPM_CH(ch)      (1UL << (ch))
+#define PPM_CH_ALL      ((1UL << PPM_ENCODER_CHANNEL_NUM) - 1)
+//the channels send_ppm() writes.
+#define SEND_PPM_CH     (PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL) | PPM_CH(THROTTLE_CHANNEL) \
+                         | PPM_CH(YAW_CHANNEL) | PPM_CH(MODE_CHANNEL) | PPM_CH(EMERGENCY_CHANNEL))
+
 typedef enum
 {
     Stabilize = 601,
@@ -42,6 +83,16 @@ typedef enum
     EMERGENCY_OFF = channel_val_MIN,
 }emergency_e;
 
+/* set to latch of the frames with new data, units: us */
+struct ppm_latency
+{
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t avg_us;    //exponential average
+    uint32_t frames;    //frame events
+    uint32_t commands;  //frames latched with new data
+};
+
 typedef struct
 {
     uint16_t ch_val[PPM_ENCODER_CHANNEL_NUM];
@@ -51,7 +102,22 @@ typedef struct
 
 extern void set_ppm_channel(ppm_data_t *ppm_data, uint16_t* channel);
 extern void ppm_encoder_init(void);
-extern void ppm_encoder_set_data(ppm_data_t *ppm_data);
+extern uint32_t ppm_encoder_set_data(ppm_data_t *ppm_data);
+extern bool ppm_frame_sent(uint32_t seq);
+extern uint32_t ppm_frames_since_set(void);
+extern void ppm_frame_subscribe(TaskHandle_t task);
+extern void ppm_frame_unsubscribe(TaskHandle_t task);
+extern void ppm_frame_event_offset(uint32_t offset_us);
+extern void ppm_latency_read(struct ppm_latency *lat);
+extern void ppm_failsafe_preload(const uint16_t *ch_val);
+extern void ppm_failsafe_trigger(void);
+extern void ppm_failsafe_clear(void);
+extern bool ppm_failsafe_active(void);
+extern uint32_t ppm_failsafe_latency_us(void);
+extern uint16_t ppm_channel_get(channel_name_e ch);
+extern void ppm_channel_claim(ppm_owner_e owner, uint32_t mask);
+extern void ppm_channel_release(ppm_owner_e owner, uint32_t mask);
+extern uint32_t ppm_channel_update(ppm_owner_e owner, uint32_t mask, const uint16_t *ch_val);
 extern void send_ppm(uint16_t channel_roll ,uint16_t channel_pitch ,uint16_t channel_throttle ,
                         uint16_t channel_yaw ,uint16_t channel_mode ,uint16_t channel_emergency);
 
@@ -0,0 +1,180 @@
+/*
+ * ppm_trace.c
+ */
+
+/* RTOS & rx23t include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "ppm_trace.h"
+
+#if PPM_TRACE_ENABLE
+
+#include "ppm_encoder.h"
+#include "printf-stdarg.h"
+
+/*-----------------------------------------------------------*/
+/* private variables */
+/* CPU clocks per CMT0 count, CMT0 counts PCLK/8. */
+#define PPM_TRACE_CYCLES_PER_CNT    (configCPU_CLOCK_HZ / (configPERIPHERAL_CLOCK_HZ / 8))
+
+struct ppm_trace_check {
+    uint32_t frames;
+    uint32_t bad_low;       /* low pulses not PPM_ENCODER_NEG_CH_VAL */
+    uint32_t bad_width;     /* channels out of channel_val_MIN..MAX */
+    uint32_t bad_period;    /* frames not PPM_ENCODER_TOTAL_CH_VAL */
+    int32_t  golden;        /* the last frame against the channels set, -1: not known. */
+};
+
+static uint8_t trace_buf[PPM_TRACE_SIZE][4];
+static uint32_t trace_head = 0;         /* records since the trace started. */
+static volatile bool trace_frozen = false;
+static uint16_t trace_isr_max = 0;
+static uint32_t trace_isr_sum = 0;      /* of the records since the trace started. */
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static uint16_t ppm_trace_cmp(const uint8_t *rec);
+static void ppm_trace_check(uint32_t start, uint32_t num, struct ppm_trace_check *chk);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * called by the TMR0 ISR for each edge. it is the fast
+ * interrupt & nothing else writes the ring, the dump only
+ * reads it while frozen. the oldest record is overwritten
+ * when the ring is full.
+ *
+ * --------------------------------------------------------*/
+void ppm_trace_edge(uint16_t cmp, bool level, uint8_t idx, uint16_t isr_cnt)
+{
+    uint8_t *rec;
+
+    if (trace_frozen) return;
+
+    if (isr_cnt > trace_isr_max) trace_isr_max = isr_cnt;
+    trace_isr_sum += isr_cnt;
+    if (isr_cnt > 0xFF) isr_cnt = 0xFF;
+
+    rec = trace_buf[trace_head & (PPM_TRACE_SIZE - 1)];
+    rec[0] = (uint8_t)cmp;
+    rec[1] = (uint8_t)(cmp >> 8);
+    rec[2] = idx | (level ? 0x80 : 0x00);
+    rec[3] = (uint8_t)isr_cnt;
+    trace_head++;
+}
+
+/* ----------------------------------------------------------
+ *
+ * prints the ring oldest first over the debug console with
+ * the checks of the frames in it, then starts a new trace.
+ * tracing is paused meanwhile.
+ *
+ * --------------------------------------------------------*/
+void ppm_trace_dump(void)
+{
+    struct ppm_trace_check chk;
+    uint32_t num, start, i;
+    const uint8_t *rec;
+
+    /* the ISR preempts anything, once the flag is seen it is done. */
+    trace_frozen = true;
+    num = (trace_head > PPM_TRACE_SIZE) ? PPM_TRACE_SIZE : trace_head;
+    start = trace_head - num;
+
+    debug_printf("\nPTRC 1 %d %d\n", (int)num, (int)(trace_head - num));
+    for (i = 0; i < num; i++) {
+        rec = trace_buf[(start + i) & (PPM_TRACE_SIZE - 1)];
+        debug_printf("%02x%02x%02x%02x%c", rec[0], rec[1], rec[2], rec[3], (i & 7) == 7 ? '\n' : ' ');
+    }
+
+    ppm_trace_check(start, num, &chk);
+    debug_printf("\nPTRC CHECK %d %d %d %d %d\n", (int)chk.frames, (int)chk.bad_low,
+                 (int)chk.bad_width, (int)chk.bad_period, (int)chk.golden);
+    debug_printf("PTRC ISR %d %d\n", (int)(trace_isr_max * PPM_TRACE_CYCLES_PER_CNT),
+                 trace_head ? (int)(trace_isr_sum * PPM_TRACE_CYCLES_PER_CNT / trace_head) : 0);
+    debug_printf("PTRC END\n");
+
+    trace_head = 0;
+    trace_isr_max = 0;
+    trace_isr_sum = 0;
+    trace_frozen = false;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+static uint16_t ppm_trace_cmp(const uint8_t *rec)
+{
+    return (uint16_t)(rec[0] | (rec[1] << 8));
+}
+
+/* ----------------------------------------------------------
+ *
+ * checks the complete frames, from an idx 0 record through
+ * PPM_EDGE_NUM in a row. the even entries are the low pulses,
+ * the odd ones the channels & the idle time last. the last
+ * frame is compared with the channels set only once it has
+ * been sent with them & the failsafe is off.
+ *
+ * --------------------------------------------------------*/
+static void ppm_trace_check(uint32_t start, uint32_t num, struct ppm_trace_check *chk)
+{
+    uint16_t width[PPM_ENCODER_CHANNEL_NUM], last[PPM_ENCODER_CHANNEL_NUM];
+    const uint8_t *rec;
+    uint32_t i, j, n, period, cmp;
+    uint8_t idx;
+    bool last_ok = false;
+
+    chk->frames = 0;
+    chk->bad_low = 0;
+    chk->bad_width = 0;
+    chk->bad_period = 0;
+    chk->golden = -1;
+
+    n = 0;
+    period = 0;
+    for (i = 0; i < num; i++) {
+        rec = trace_buf[(start + i) & (PPM_TRACE_SIZE - 1)];
+        idx = rec[2] & 0x7F;
+        cmp = ppm_trace_cmp(rec);
+        if (idx == 0) {
+            n = 0;
+            period = 0;
+        } else if (idx != n) {
+            /* not from the frame start, or records lost. */
+            n = PPM_EDGE_NUM + 1;
+            continue;
+        }
+        if (n > PPM_EDGE_NUM) continue;
+
+        period += cmp;
+        if (!(idx & 1)) {
+            if (cmp != PPM_ENCODER_NEG_CH_VAL * PPM_CNT_PER_US) chk->bad_low++;
+        } else if (idx < PPM_EDGE_NUM - 1) {
+            width[idx / 2] = (uint16_t)(cmp / PPM_CNT_PER_US);
+            if (cmp < channel_val_MIN * PPM_CNT_PER_US || cmp > channel_val_MAX * PPM_CNT_PER_US)
+                chk->bad_width++;
+        }
+        if (++n == PPM_EDGE_NUM) {
+            chk->frames++;
+            if (period != PPM_ENCODER_TOTAL_CH_VAL * PPM_CNT_PER_US) chk->bad_period++;
+            for (j = 0; j < PPM_ENCODER_CHANNEL_NUM; j++)
+                last[j] = width[j];
+            last_ok = true;
+        }
+    }
+
+    if (last_ok && !ppm_failsafe_active() && ppm_frames_since_set() > 0) {
+        chk->golden = 1;
+        for (i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++) {
+            if (last[i] != ppm_channel_get((channel_name_e)i)) chk->golden = 0;
+        }
+    }
+}
+
+#endif /* PPM_TRACE_ENABLE */
@@ -0,0 +1,41 @@
+/*
+ * ppm_trace.h
+ */
+
+#ifndef TOOLS_PPM_TRACE_H_
+#define TOOLS_PPM_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the trace ring takes 4 * PPM_TRACE_SIZE bytes of RAM & time
+ * in the PPM ISR, so it is left out of flight builds. */
+#define PPM_TRACE_ENABLE    0
+#define PPM_TRACE_SIZE      256     /* records, must be a power of two. */
+
+/* ----------------------------------------------------------
+ *
+ * every edge the TMR0 ISR sets up is one record, dumped as 8
+ * hex digits:
+ *  cmp(2, little endian), idx | level << 7, isr
+ * cmp is in TMR0 counts(5MHz), the sum of the cmp before an
+ * edge is its time. idx is the entry of the frame table, 0
+ * starts a frame. isr is the ISR time in CMT0 counts(5MHz),
+ * saturated at 0xFF. the dump starts with a line
+ *  PTRC 1 <records> <overwritten>
+ * then the hex records, the checks of the complete frames:
+ *  PTRC CHECK <frames> <bad low> <bad width> <bad period> <golden>
+ * golden is 1 when the last frame has the channels last set.
+ *  PTRC ISR <max cycles> <average cycles>
+ * and ends with a line "PTRC END".
+ *
+ * --------------------------------------------------------*/
+#if PPM_TRACE_ENABLE
+extern void ppm_trace_edge(uint16_t cmp, bool level, uint8_t idx, uint16_t isr_cnt);
+extern void ppm_trace_dump(void);
+#else
+#define ppm_trace_edge(cmp, level, idx, isr_cnt)
+#define ppm_trace_dump()
+#endif
+
+#endif /* TOOLS_PPM_TRACE_H_ */
@@ -0,0 +1,206 @@
+/*
+ * sbus_encoder.c
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform.h"
+#include "r_cg_sci.h"
+
+#include "sbus_encoder.h"
+#include "timestamp.h"
+
+/*-----------------------------------------------------------*/
+/* private variables */
+/* CMT1 counts PCLK/32 for the frame period. */
+#define SBUS_CMT_CNT_PER_MS     (configPERIPHERAL_CLOCK_HZ / 32 / 1000)
+#define SBUS_CMT_PRIORITY       4
+/* 100000 baud from PCLK with 8 base clocks a bit, n = 0. */
+#define SBUS_BRR                (configPERIPHERAL_CLOCK_HZ / 16 / 100000 - 1)
+
+struct sbus_frame {
+    uint8_t  data[SBUS_FRAME_LEN];
+    uint32_t seq;
+};
+
+/* triple buffer between the writer & the frame timer, as in ppm_encoder.c. */
+#define SBUS_BUF_NUM    3
+#define SBUS_TB_NEW     0x04
+#define SBUS_TB_IDX     0x03
+static struct sbus_frame sbus_frame_buf[SBUS_BUF_NUM];
+static signed long sbus_tb_write;
+static signed long sbus_tb_latest;
+static signed long sbus_tb_read;
+/* the frame on the line, NULL while none has been started. */
+static struct sbus_frame *sbus_sending = NULL;
+
+static uint32_t sbus_seq_set;
+static volatile uint32_t sbus_seq_sent;
+static volatile uint32_t sbus_since_set;
+static uint32_t sbus_pack_us;
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void sbus_sci_config(void);
+static void sbus_timer_config(void);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * takes SCI5 over & starts the frame timer. every channel is
+ * SBUS_CH_IDLE until the first set.
+ * NOTE:SCI5 is the car link otherwise, see PPM_OUTPUT_SBUS.
+ *
+ * --------------------------------------------------------*/
+void sbus_encoder_init(void)
+{
+    uint16_t val[SBUS_CHANNEL_NUM];
+    uint32_t i;
+
+    for (i = 0; i < SBUS_CHANNEL_NUM; i++)
+        val[i] = SBUS_CH_IDLE;
+    for (i = 0; i < SBUS_BUF_NUM; i++) {
+        sbus_pack(val, 0, sbus_frame_buf[i].data);
+        sbus_frame_buf[i].seq = 0;
+    }
+    sbus_tb_read = 0;
+    sbus_tb_latest = 1;
+    sbus_tb_write = 2;
+    sbus_seq_set = 0;
+    sbus_seq_sent = 0;
+    sbus_since_set = 0;
+
+    sbus_sci_config();
+    sbus_timer_config();
+}
+
+/* ----------------------------------------------------------
+ *
+ * packs the pulse widths(us) of the first num channels, the
+ * rest stay SBUS_CH_IDLE. the frame timer sends the latest
+ * frame at its next period. returns its sequence number.
+ * NOTE:one writer at a time.
+ *
+ * --------------------------------------------------------*/
+uint32_t sbus_encoder_set(const uint16_t *pulse_us, uint32_t num)
+{
+    struct sbus_frame *frame = sbus_frame_buf + sbus_tb_write;
+    uint16_t val[SBUS_CHANNEL_NUM];
+    uint32_t i, t_in;
+
+    t_in = timestamp_us();
+    for (i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        if (i >= num || pulse_us[i] <= 880)
+            val[i] = SBUS_CH_IDLE;
+        else
+            val[i] = SBUS_US_TO_VAL(pulse_us[i]);
+    }
+    sbus_pack(val, 0, frame->data);
+    frame->seq = ++sbus_seq_set;
+    sbus_tb_write |= SBUS_TB_NEW;
+    xchg(&sbus_tb_write, &sbus_tb_latest);
+    sbus_tb_write &= SBUS_TB_IDX;
+    t_in = timestamp_us() - t_in;
+    if (t_in > sbus_pack_us) sbus_pack_us = t_in;
+
+    return sbus_seq_set;
+}
+
+/* true once the frame of seq, or a later one, has been sent in full. */
+bool sbus_frame_sent(uint32_t seq)
+{
+    return (int32_t)(sbus_seq_sent - seq) >= 0;
+}
+
+/* frames sent in full with the data of the last set. */
+uint32_t sbus_frames_since_set(void)
+{
+    uint32_t seq, n;
+
+    taskENTER_CRITICAL();
+    seq = sbus_seq_sent;
+    n = sbus_since_set;
+    taskEXIT_CRITICAL();
+
+    return seq == sbus_seq_set ? n : 0;
+}
+
+/* the longest sbus_encoder_set() so far, units: us */
+uint32_t sbus_pack_us_max(void)
+{
+    return sbus_pack_us;
+}
+
+/* ----------------------------------------------------------
+ *
+ * CMT1, once a frame period. the frame started last period
+ * is done by now, 25 bytes take 3ms. latches the latest frame
+ * & starts sending it.
+ *
+ * --------------------------------------------------------*/
+#pragma interrupt sbus_frame_interrupt(vect=VECT(CMT1,CMI1))
+static void sbus_frame_interrupt(void)
+{
+    /* still on the line, the period is too short for the baud rate. */
+    if (SCI5.SCR.BIT.TE) return;
+
+    if (sbus_sending != NULL) {
+        if (sbus_sending->seq != sbus_seq_sent) {
+            sbus_seq_sent = sbus_sending->seq;
+            sbus_since_set = 0;
+        }
+        sbus_since_set++;
+    }
+    if (sbus_tb_latest & SBUS_TB_NEW) {
+        xchg(&sbus_tb_read, &sbus_tb_latest);
+        sbus_tb_read &= SBUS_TB_IDX;
+    }
+    sbus_sending = sbus_frame_buf + sbus_tb_read;
+    R_SCI5_Serial_Send(sbus_sending->data, SBUS_FRAME_LEN);
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+/* SCI5 was set up for the car link by R_SCI5_Create(), it is
+ * stopped, so the format can be changed. */
+static void sbus_sci_config(void)
+{
+    SCI5.SCR.BYTE = _00_SCI_INTERNAL_SCK_UNUSED;
+    SCI5.SMR.BYTE = _00_SCI_CLOCK_PCLK | _08_SCI_STOP_2 | _20_SCI_PARITY_ENABLE | _00_SCI_PARITY_EVEN |
+                    _00_SCI_DATA_LENGTH_8 | _00_SCI_MULTI_PROCESSOR_DISABLE | _00_SCI_ASYNCHRONOUS_MODE;
+    SCI5.SEMR.BYTE = _00_SCI_LOW_LEVEL_START_BIT | _00_SCI_NOISE_FILTER_DISABLE | _10_SCI_8_BASE_CLOCK |
+                     _00_SCI_BAUDRATE_SINGLE | _00_SCI_BIT_MODULATION_DISABLE;
+    SCI5.BRR = SBUS_BRR;
+    R_SCI5_Start();
+}
+
+static void sbus_timer_config(void)
+{
+    const uint32_t ulEnableRegisterWrite = 0xA50BUL, ulDisableRegisterWrite = 0xA500UL;
+
+    /* Disable register write protection. */
+    SYSTEM.PRCR.WORD = ulEnableRegisterWrite;
+
+    /* Enable compare match timer 1. */
+    MSTP(CMT1) = 0;
+    CMT.CMSTR0.BIT.STR1 = 0;
+
+    /* Divide the PCLK by 32, interrupt on compare match. */
+    CMT1.CMCR.BIT.CKS = 1;
+    CMT1.CMCR.BIT.CMIE = 1;
+    CMT1.CMCOR = (unsigned short)(SBUS_FRAME_MS * SBUS_CMT_CNT_PER_MS - 1);
+    CMT1.CMCNT = 0;
+
+    IR(CMT1, CMI1) = 0;
+    IPR(CMT1, CMI1) = SBUS_CMT_PRIORITY;
+    IEN(CMT1, CMI1) = 1;
+
+    /* Start the timer. */
+    CMT.CMSTR0.BIT.STR1 = 1;
+
+    /* Reneable register protection. */
+    SYSTEM.PRCR.WORD = ulDisableRegisterWrite;
+}
@@ -0,0 +1,37 @@
+/*
+ * sbus_encoder.h
+ */
+
+#ifndef TOOLS_SBUS_ENCODER_H_
+#define TOOLS_SBUS_ENCODER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ----------------------------------------------------------
+ *
+ * SBUS: 100000 baud 8E2, 25 bytes a frame, 16 channels of
+ * 11 bits packed LSB first. the line is inverted, SCI5 sends
+ * it as a plain UART so an inverter is needed on TXD5.
+ *
+ * --------------------------------------------------------*/
+#define SBUS_FRAME_LEN      25
+#define SBUS_CHANNEL_NUM    16
+#define SBUS_HEADER         0x0F
+#define SBUS_FOOTER         0x00
+#define SBUS_FLAG_FRAME_LOST 0x04
+#define SBUS_FLAG_FAILSAFE  0x08
+#define SBUS_FRAME_MS       14      /* 7 for the high speed mode. */
+#define SBUS_VAL_MAX        2047
+/* the usual receiver mapping, us = 880 + 0.625 * value. */
+#define SBUS_US_TO_VAL(us)  ((uint16_t)(((us) - 880) * 8 / 5))
+#define SBUS_CH_IDLE        SBUS_US_TO_VAL(1500)    /* channels without a value. */
+
+extern void sbus_encoder_init(void);
+extern uint32_t sbus_encoder_set(const uint16_t *pulse_us, uint32_t num);
+extern void sbus_pack(const uint16_t *val, uint8_t flags, uint8_t *frame);
+extern bool sbus_frame_sent(uint32_t seq);
+extern uint32_t sbus_frames_since_set(void);
+extern uint32_t sbus_pack_us_max(void);
+
+#endif /* TOOLS_SBUS_ENCODER_H_ */
@@ -0,0 +1,38 @@
+/*
+ * sbus_pack.c
+ */
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "sbus_encoder.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * 16 values of 11 bits, LSB first, fill the 22 bytes after
+ * the header exactly. values above SBUS_VAL_MAX are cut to
+ * their 11 bits.
+ *
+ * --------------------------------------------------------*/
+void sbus_pack(const uint16_t *val, uint8_t flags, uint8_t *frame)
+{
+    uint8_t *p = frame + 1;
+    uint32_t bits = 0;
+    int nbits = 0;
+    int i;
+
+    frame[0] = SBUS_HEADER;
+    for (i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        bits |= (uint32_t)(val[i] & SBUS_VAL_MAX) << nbits;
+        nbits += 11;
+        while (nbits >= 8) {
+            *p++ = (uint8_t)bits;
+            bits >>= 8;
+            nbits -= 8;
+        }
+    }
+    frame[SBUS_FRAME_LEN - 2] = flags;
+    frame[SBUS_FRAME_LEN - 1] = SBUS_FOOTER;
+}
@@ -0,0 +1,98 @@
+/*
+ * serial_capture.c
+ */
+
+/* RTOS & rx23t include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "serial_capture.h"
+
+#if SERIAL_CAPTURE_ENABLE
+
+#include "timestamp.h"
+#include "printf-stdarg.h"
+
+/*-----------------------------------------------------------*/
+/* private variables */
+static uint8_t capture_buf[SERIAL_CAPTURE_SIZE][4];
+static uint32_t capture_head = 0;       /* records since the capture started. */
+static uint32_t capture_last_us = 0;
+static volatile bool capture_frozen = false;
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void capture_put(uint16_t dt, uint8_t port, uint8_t byte);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * called by the SCI receive interrupts. both run at the same
+ * level, so they never preempt each other. the oldest record
+ * is overwritten when the ring is full.
+ *
+ * --------------------------------------------------------*/
+void serial_capture_byte(serial_port_e port, uint8_t byte)
+{
+    uint32_t now, dt;
+
+    if (capture_frozen) return;
+
+    now = timestamp_us();
+    dt = now - capture_last_us;
+    capture_last_us = now;
+    if (dt > 0xFFFF) {
+        if (dt > 0xFFFFFF) dt = 0xFFFFFF;
+        capture_put((uint16_t)dt, SERIAL_CAPTURE_GAP, (uint8_t)(dt >> 16));
+        dt = 0;
+    }
+    capture_put((uint16_t)dt, (uint8_t)port, byte);
+}
+
+/* ----------------------------------------------------------
+ *
+ * prints the ring oldest first over the debug console, then
+ * starts a new capture. capturing is paused meanwhile.
+ *
+ * --------------------------------------------------------*/
+void serial_capture_dump(void)
+{
+    uint32_t num, start;
+    const uint8_t *rec;
+
+    capture_frozen = true;
+    num = (capture_head > SERIAL_CAPTURE_SIZE) ? SERIAL_CAPTURE_SIZE : capture_head;
+    start = capture_head - num;
+
+    debug_printf("\nSCAP %d %d %d\n", SERIAL_CAPTURE_VERSION, (int)num, (int)(capture_head - num));
+    for (uint32_t i = 0; i < num; i++) {
+        rec = capture_buf[(start + i) & (SERIAL_CAPTURE_SIZE - 1)];
+        debug_printf("%02x%02x%02x%02x%c", rec[0], rec[1], rec[2], rec[3], (i & 7) == 7 ? '\n' : ' ');
+    }
+    debug_printf("\nSCAP END\n");
+
+    taskENTER_CRITICAL();
+    capture_head = 0;
+    capture_last_us = timestamp_us();
+    capture_frozen = false;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+static void capture_put(uint16_t dt, uint8_t port, uint8_t byte)
+{
+    uint8_t *rec = capture_buf[capture_head & (SERIAL_CAPTURE_SIZE - 1)];
+
+    rec[0] = (uint8_t)dt;
+    rec[1] = (uint8_t)(dt >> 8);
+    rec[2] = port;
+    rec[3] = byte;
+    capture_head++;
+}
+
+#endif /* SERIAL_CAPTURE_ENABLE */
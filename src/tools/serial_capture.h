@@ -0,0 +1,41 @@
+/*
+ * serial_capture.h
+ */
+
+#ifndef TOOLS_SERIAL_CAPTURE_H_
+#define TOOLS_SERIAL_CAPTURE_H_
+
+#include <stdint.h>
+#include "serial_stats.h"
+
+/* the capture ring takes 4 * SERIAL_CAPTURE_SIZE bytes of RAM,
+ * so it is left out of flight builds. */
+#define SERIAL_CAPTURE_ENABLE   0
+#define SERIAL_CAPTURE_SIZE     512     /* records, must be a power of two. */
+
+/* ----------------------------------------------------------
+ *
+ * every received byte is one record, dumped as 8 hex digits:
+ *  dt_us(2, little endian), port, byte
+ * dt_us is the time since the previous record of either port.
+ * a gap over 0xFFFF us is put in a record of its own first,
+ * with port SERIAL_CAPTURE_GAP & bits 16..23 of the gap as
+ * byte, saturated at 0xFFFFFF us, the byte record after it
+ * has dt_us 0. the dump starts with a line
+ *  SCAP 2 <records> <overwritten>
+ * and ends with a line "SCAP END". version 1 dumps had no gap
+ * records, their dt_us saturated at 0xFFFF.
+ *
+ * --------------------------------------------------------*/
+#define SERIAL_CAPTURE_VERSION  2
+#define SERIAL_CAPTURE_GAP      0xFF
+
+#if SERIAL_CAPTURE_ENABLE
+extern void serial_capture_byte(serial_port_e port, uint8_t byte);
+extern void serial_capture_dump(void);
+#else
+#define serial_capture_byte(port, byte)
+#define serial_capture_dump()
+#endif
+
+#endif /* TOOLS_SERIAL_CAPTURE_H_ */
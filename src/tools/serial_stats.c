@@ -0,0 +1,125 @@
+/*
+ * serial_stats.c
+ */
+
+/* RTOS & rx23t include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform.h"
+#include "r_cg_sci.h"
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "serial_stats.h"
+#include "timestamp.h"
+
+/*-----------------------------------------------------------*/
+/* private types. */
+struct serial_counters {
+    struct serial_stats stats;
+    uint32_t gap_sum_us;
+    uint32_t gap_num;
+    uint32_t last_frame_us;
+    bool has_last_frame;
+};
+
+/*-----------------------------------------------------------*/
+/* private variables */
+static struct serial_counters serial_counters[SERIAL_PORT_NUM];
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * all updates mask the SCI interrupts, so they can be called
+ * from the receive interrupts and from tasks.
+ *
+ * --------------------------------------------------------*/
+void serial_stats_rx_byte(serial_port_e port)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    serial_counters[port].stats.rx_bytes++;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/* ----------------------------------------------------------
+ *
+ * called by the receive error interrupt with the SSR value
+ * read before its error flags are cleared.
+ *
+ * --------------------------------------------------------*/
+void serial_stats_rx_error(serial_port_e port, uint8_t ssr)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    if (ssr & _20_SCI_OVERRUN_ERROR) serial_counters[port].stats.overruns++;
+    if (ssr & _10_SCI_FRAME_ERROR)   serial_counters[port].stats.framing_errors++;
+    if (ssr & _08_SCI_PARITY_ERROR)  serial_counters[port].stats.parity_errors++;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void serial_stats_frame(serial_port_e port, bool ok)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    if (ok) {
+        serial_counters[port].stats.frames_ok++;
+    } else {
+        serial_counters[port].stats.frames_rejected++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/* ----------------------------------------------------------
+ *
+ * marks the last byte of a frame, called by the receive
+ * interrupt so the inter-frame gap has no task latency in it.
+ *
+ * --------------------------------------------------------*/
+void serial_stats_frame_end(serial_port_e port)
+{
+    struct serial_counters *c = &serial_counters[port];
+    uint32_t now = timestamp_us();
+    uint32_t gap;
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    if (c->has_last_frame) {
+        gap = now - c->last_frame_us;
+        if (c->gap_num == 0 || gap < c->stats.gap_min_us) c->stats.gap_min_us = gap;
+        if (gap > c->stats.gap_max_us) c->stats.gap_max_us = gap;
+        c->gap_sum_us += gap;
+        c->gap_num++;
+    }
+    c->last_frame_us = now;
+    c->has_last_frame = true;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void serial_stats_read(serial_port_e port, struct serial_stats *stats)
+{
+    struct serial_counters *c = &serial_counters[port];
+
+    taskENTER_CRITICAL();
+    *stats = c->stats;
+    stats->gap_avg_us = c->gap_num ? c->gap_sum_us / c->gap_num : 0;
+    taskEXIT_CRITICAL();
+}
+
+void serial_stats_reset(serial_port_e port)
+{
+    struct serial_counters *c = &serial_counters[port];
+
+    taskENTER_CRITICAL();
+    c->stats.rx_bytes        = 0;
+    c->stats.frames_ok       = 0;
+    c->stats.frames_rejected = 0;
+    c->stats.overruns        = 0;
+    c->stats.framing_errors  = 0;
+    c->stats.parity_errors   = 0;
+    c->stats.gap_min_us      = 0;
+    c->stats.gap_avg_us      = 0;
+    c->stats.gap_max_us      = 0;
+    c->gap_sum_us            = 0;
+    c->gap_num               = 0;
+    c->has_last_frame        = false;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,36 @@
+/*
+ * serial_stats.h
+ */
+
+#ifndef TOOLS_SERIAL_STATS_H_
+#define TOOLS_SERIAL_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    SERIAL_PORT_CAM = 0,    /* SCI1 */
+    SERIAL_PORT_CAR = 1,    /* SCI5 */
+    SERIAL_PORT_NUM
+} serial_port_e;
+
+struct serial_stats {
+    uint32_t rx_bytes;
+    uint32_t frames_ok;
+    uint32_t frames_rejected;
+    uint32_t overruns;
+    uint32_t framing_errors;
+    uint32_t parity_errors;
+    uint32_t gap_min_us;    /* between two frames, 0 until there are two. */
+    uint32_t gap_avg_us;
+    uint32_t gap_max_us;
+};
+
+extern void serial_stats_rx_byte(serial_port_e port);
+extern void serial_stats_rx_error(serial_port_e port, uint8_t ssr);
+extern void serial_stats_frame(serial_port_e port, bool ok);
+extern void serial_stats_frame_end(serial_port_e port);
+extern void serial_stats_read(serial_port_e port, struct serial_stats *stats);
+extern void serial_stats_reset(serial_port_e port);
+
+#endif /* TOOLS_SERIAL_STATS_H_ */
@@ -5,36 +5,272 @@
  *      Author: Cotyledon
  */
 
+#include "FreeRTOS.h"
+#include "task.h"
 #include "platform.h"
 #include "r_cg_mtu3.h"
 
+#include "sonar.h"
+#include "timestamp.h"
+
+/*-----------------------------------------------------------*/
+/* private variables */
+struct sonar_echo {
+    uint16_t count;         /* MTU5 U counts from rising to falling edge. */
+    uint32_t t_us;
+};
+
 volatile float current_Height;
-static volatile float last_height = 0.0f;
-static volatile unsigned short sonar_count = 0;
-static const float sonar_lpf = 15.9155e-3;
+/* counts the height samples, a reader can tell a new one. */
+volatile uint32_t sonar_samples = 0;
+
 static volatile bool first_edge = true;
+/* timestamp_us() of the last capture edge, for the echo timeout. */
+static volatile uint32_t sonar_edge_us = 0;
+/* written by the ISR at head, read by the task at tail. */
+static struct sonar_echo sonar_ring[SONAR_RING_SIZE];
+static volatile uint8_t sonar_ring_head = 0;
+static volatile uint8_t sonar_ring_tail = 0;
+
+static TaskHandle_t sonar_taskhandle = NULL;
+static TaskHandle_t sonar_subscriber[SONAR_SUBSCRIBER_MAX];
+static struct sonar_sample sonar_sample;
+static uint32_t sonar_valid_us = 0;
+/* the ISR & the task write different members. */
+static struct sonar_stats sonar_stats;
+
+/* only used by the sonar task. */
+static struct sonar_filter sonar_filter;
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static void sonar_task_entry(void *pvParameters);
+static void sonar_echo(const struct sonar_echo *e);
+static void sonar_echo_timeout(void);
+static void sonar_publish(float height, uint32_t t_us, bool valid);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
 
 void sonar_init(void)
 {
+    BaseType_t ret;
+
+    sonar_filter_init(&sonar_filter);
+    ret = xTaskCreate(sonar_task_entry,
+                      "sonar",
+                      configMINIMAL_STACK_SIZE,
+                      NULL,
+                      SONAR_TASK_PRI,
+                      &sonar_taskhandle);
+    configASSERT(ret == pdPASS);
+
+    /* the age of the data counts from here until the first sample. */
+    sonar_valid_us = timestamp_us();
+    /* the level comes from the code generator, the ISR makes RTOS calls. */
+    configASSERT(IPR(MTU5, TGIU5) == SONAR_PRIORITY);
     R_MTU3_C5_Start();
 }
 
+/* ----------------------------------------------------------
+ *
+ * copies the latest published sample.
+ *
+ * --------------------------------------------------------*/
+void sonar_read(struct sonar_sample *s)
+{
+    taskENTER_CRITICAL();
+    *s = sonar_sample;
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * the task gets a notification (xTaskNotifyGive) each time a
+ * sample has been published, valid or not.
+ * NOTE:unsubscribe a task before deleting it.
+ *
+ * --------------------------------------------------------*/
+void sonar_subscribe(TaskHandle_t task)
+{
+    int i;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < SONAR_SUBSCRIBER_MAX; i++) {
+        if (sonar_subscriber[i] == task) break;
+    }
+    if (i == SONAR_SUBSCRIBER_MAX) {
+        for (i = 0; i < SONAR_SUBSCRIBER_MAX; i++) {
+            if (sonar_subscriber[i] == NULL) {
+                sonar_subscriber[i] = task;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+    configASSERT(i < SONAR_SUBSCRIBER_MAX);
+}
+
+void sonar_unsubscribe(TaskHandle_t task)
+{
+    int i;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < SONAR_SUBSCRIBER_MAX; i++) {
+        if (sonar_subscriber[i] == task) sonar_subscriber[i] = NULL;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void sonar_stats_read(struct sonar_stats *st)
+{
+    taskENTER_CRITICAL();
+    *st = sonar_stats;
+    taskEXIT_CRITICAL();
+}
+
+/* ----------------------------------------------------------
+ *
+ * time since the last valid sample, units: us. before the
+ * first one it is the time since sonar_init().
+ *
+ * --------------------------------------------------------*/
+uint32_t sonar_data_age_us(void)
+{
+    uint32_t t_us;
+
+    taskENTER_CRITICAL();
+    t_us = sonar_valid_us;
+    taskEXIT_CRITICAL();
+
+    return timestamp_us() - t_us;
+}
+
+/* ----------------------------------------------------------
+ *
+ * MTU5 TGIU5, at a level the RTOS can mask. only the raw
+ * capture is stored, the task does the rest.
+ *
+ * --------------------------------------------------------*/
 void sonar_interrupt(void)
 {
-    setpsw_i();
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t t_in = timestamp_us();
+    uint32_t dt;
+    uint8_t head;
+
+    sonar_edge_us = t_in;
     if (first_edge) {
-        sonar_count = 0;
         MTU5.TGRU = 0;
         MTU5.TIORU.BYTE = _12_MTU5_IOC_F;
         first_edge = false;
     } else {
-        sonar_count = MTU5.TGRU;
-        float sonar_dt = (float)sonar_count / 2500000 ;
-        current_Height = sonar_dt / 2 * 340;
-        current_Height = last_height + sonar_dt / (sonar_lpf + sonar_dt) * (current_Height - last_height);
-        last_height = current_Height;
+        head = sonar_ring_head;
+        if ((uint8_t)(head - sonar_ring_tail) < SONAR_RING_SIZE) {
+            sonar_ring[head & (SONAR_RING_SIZE - 1)].count = MTU5.TGRU;
+            sonar_ring[head & (SONAR_RING_SIZE - 1)].t_us = t_in;
+            sonar_ring_head = head + 1;
+        } else {
+            sonar_stats.dropped++;
+        }
+        sonar_stats.echoes++;
+        MTU5.TIORU.BYTE = _11_MTU5_IOC_R;
+        first_edge = true;
+        vTaskNotifyGiveFromISR(sonar_taskhandle, &xHigherPriorityTaskWoken);
+    }
+
+    dt = timestamp_us() - t_in;
+    if (dt > sonar_stats.isr_us_max) sonar_stats.isr_us_max = dt;
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+static void sonar_task_entry(void *pvParameters)
+{
+    struct sonar_echo e;
+    uint32_t t_in, dt;
+    uint8_t tail;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SONAR_ECHO_TIMEOUT_MS));
+        tail = sonar_ring_tail;
+        while (tail != sonar_ring_head) {
+            e = sonar_ring[tail & (SONAR_RING_SIZE - 1)];
+            sonar_ring_tail = ++tail;
+
+            t_in = timestamp_us();
+            sonar_echo(&e);
+            dt = timestamp_us() - t_in;
+            if (dt > sonar_stats.filter_us_max) sonar_stats.filter_us_max = dt;
+            sonar_stats.filter_us_avg += ((int32_t)dt - (int32_t)sonar_stats.filter_us_avg) / 8;
+        }
+        sonar_echo_timeout();
+    }
+}
+
+/* ----------------------------------------------------------
+ *
+ * with no falling edge SONAR_ECHO_TIMEOUT_MS after the rising
+ * one the echo is taken as lost, the capture waits for the
+ * next rising edge again and an invalid sample is published.
+ * a sensor that gives no rising edge at all publishes nothing,
+ * sonar_data_age_us() then keeps growing.
+ *
+ * --------------------------------------------------------*/
+static void sonar_echo_timeout(void)
+{
+    uint32_t now_us;
+    bool timed_out;
+
+    /* the capture interrupt is masked here, the edge can not move. */
+    taskENTER_CRITICAL();
+    now_us = timestamp_us();
+    timed_out = !first_edge &&
+                now_us - sonar_edge_us > SONAR_ECHO_TIMEOUT_MS * 1000UL;
+    if (timed_out) {
         MTU5.TIORU.BYTE = _11_MTU5_IOC_R;
         first_edge = true;
+        sonar_edge_us = now_us;
+    }
+    taskEXIT_CRITICAL();
+
+    if (timed_out) {
+        sonar_stats.missed++;
+        sonar_publish(sonar_filter_miss(&sonar_filter), now_us, false);
     }
+}
 
+/* runs one echo through the filter & publishes the result. */
+static void sonar_echo(const struct sonar_echo *e)
+{
+    sonar_filter_e ret;
+    float height;
+
+    ret = sonar_filter_echo(&sonar_filter, e->count, e->t_us, &height);
+    if (ret == SONAR_FILTER_RANGE) sonar_stats.out_of_range++;
+    if (ret == SONAR_FILTER_LIMITED) sonar_stats.rate_limited++;
+    sonar_publish(height, e->t_us, ret == SONAR_FILTER_VALID || ret == SONAR_FILTER_LIMITED);
+}
+
+static void sonar_publish(float height, uint32_t t_us, bool valid)
+{
+    int i;
+
+    taskENTER_CRITICAL();
+    sonar_sample.height = height;
+    sonar_sample.t_us = t_us;
+    sonar_sample.valid = valid;
+    sonar_sample.id++;
+    if (valid) {
+        sonar_valid_us = t_us;
+        current_Height = height;
+        sonar_samples++;
+    }
+    for (i = 0; i < SONAR_SUBSCRIBER_MAX; i++) {
+        if (sonar_subscriber[i] != NULL)
+            xTaskNotifyGive(sonar_subscriber[i]);
+    }
+    taskEXIT_CRITICAL();
 }
@@ -8,8 +8,50 @@
 #ifndef TOOLS_SONAR_H_
 #define TOOLS_SONAR_H_
 
-extern float current_Height;
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "sonar_filter.h"
+
+#define SONAR_TASK_PRI      6
+/* the capture interrupt level set by the code generator, at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY. */
+#define SONAR_PRIORITY      5
+#define SONAR_RING_SIZE     8           /* raw echoes between ISR & task, a power of two. */
+#define SONAR_SUBSCRIBER_MAX 3
+/* no falling edge this long after an edge is a missed echo, longer
+ * than the 38ms pulse the module gives when nothing comes back. */
+#define SONAR_ECHO_TIMEOUT_MS 60
+
+struct sonar_sample {
+    float    height;        /* units: m */
+    uint32_t t_us;          /* timestamp_us() of the echo. */
+    uint32_t id;            /* counts the published samples. */
+    bool     valid;         /* the median window is full of echoes in range. */
+};
+
+/* cost & health of the pipeline, times in us. */
+struct sonar_stats {
+    uint32_t echoes;        /* raw echoes captured. */
+    uint32_t dropped;       /* lost because the ring was full. */
+    uint32_t out_of_range;
+    uint32_t missed;        /* echoes timed out, the capture was re-armed. */
+    uint32_t rate_limited;
+    uint32_t isr_us_max;
+    uint32_t filter_us_max;
+    uint32_t filter_us_avg; /* exponential average. */
+};
+
+/* the last valid height & its count, kept for the pollers. */
+extern volatile float current_Height;
+extern volatile uint32_t sonar_samples;
 
 extern void sonar_init(void);
+extern void sonar_read(struct sonar_sample *s);
+extern void sonar_subscribe(TaskHandle_t task);
+extern void sonar_unsubscribe(TaskHandle_t task);
+extern void sonar_stats_read(struct sonar_stats *st);
+extern uint32_t sonar_data_age_us(void);
 
 #endif /* TOOLS_SONAR_H_ */
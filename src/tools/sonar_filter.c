@@ -0,0 +1,99 @@
+/*
+ * sonar_filter.c
+ */
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "sonar_filter.h"
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static uint16_t sonar_median(const struct sonar_filter *sf);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+void sonar_filter_init(struct sonar_filter *sf)
+{
+    sf->idx = 0;
+    sf->num = 0;
+    sf->misses = 0;
+    sf->last_valid = false;
+    sf->last_height = 0.0f;
+    sf->last_us = 0;
+}
+
+/* ----------------------------------------------------------
+ *
+ * filters one echo of count MTU5 counts captured at t_us.
+ * height is the output, the raw height while the window
+ * fills, the last height for an echo out of range.
+ *
+ * --------------------------------------------------------*/
+sonar_filter_e sonar_filter_echo(struct sonar_filter *sf, uint16_t count, uint32_t t_us,
+                                 float *height)
+{
+    sonar_filter_e ret = SONAR_FILTER_VALID;
+    float h, step, dt;
+
+    h = (float)count * SONAR_M_PER_CNT;
+    if (h < SONAR_H_MIN || h > SONAR_H_MAX) {
+        *height = sonar_filter_miss(sf);
+        return SONAR_FILTER_RANGE;
+    }
+    sf->misses = 0;
+
+    sf->window[sf->idx] = count;
+    if (++sf->idx >= SONAR_MEDIAN_N) sf->idx = 0;
+    if (sf->num < SONAR_MEDIAN_N) sf->num++;
+    if (sf->num < SONAR_MEDIAN_N) {
+        *height = h;
+        return SONAR_FILTER_FILL;
+    }
+
+    h = (float)sonar_median(sf) * SONAR_M_PER_CNT;
+    if (sf->last_valid) {
+        dt = (float)(t_us - sf->last_us) * 1e-6f;
+        step = SONAR_RATE_MAX * dt;
+        if (h > sf->last_height + step) {
+            h = sf->last_height + step;
+            ret = SONAR_FILTER_LIMITED;
+        } else if (h < sf->last_height - step) {
+            h = sf->last_height - step;
+            ret = SONAR_FILTER_LIMITED;
+        }
+    }
+    sf->last_height = h;
+    sf->last_us = t_us;
+    sf->last_valid = true;
+    *height = h;
+    return ret;
+}
+
+/* an echo out of range or lost, returns the last height. */
+float sonar_filter_miss(struct sonar_filter *sf)
+{
+    if (++sf->misses > SONAR_MEDIAN_N / 2) {
+        sf->misses = SONAR_MEDIAN_N / 2 + 1;
+        sf->num = 0;
+        sf->last_valid = false;
+    }
+    return sf->last_height;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+
+/* the window is small, an insertion sort on a copy will do. */
+static uint16_t sonar_median(const struct sonar_filter *sf)
+{
+    uint16_t w[SONAR_MEDIAN_N], v;
+    int i, j;
+
+    for (i = 0; i < SONAR_MEDIAN_N; i++) {
+        v = sf->window[i];
+        for (j = i; j > 0 && w[j - 1] > v; j--)
+            w[j] = w[j - 1];
+        w[j] = v;
+    }
+    return w[SONAR_MEDIAN_N / 2];
+}
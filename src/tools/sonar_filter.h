@@ -0,0 +1,52 @@
+/*
+ * sonar_filter.h
+ */
+
+#ifndef TOOLS_SONAR_FILTER_H_
+#define TOOLS_SONAR_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* MTU5 U counts PCLK/16, the echo time is there and back. */
+#define SONAR_CNT_PER_S     2500000
+#define SONAR_SOUND_SPEED   340.0f      /* units: m/s */
+#define SONAR_M_PER_CNT     (SONAR_SOUND_SPEED / 2 / SONAR_CNT_PER_S)
+#define SONAR_MEDIAN_N      5           /* odd, the median of the last N echoes. */
+#define SONAR_H_MIN         0.02f       /* echoes outside are not valid, units: m */
+#define SONAR_H_MAX         4.0f
+#define SONAR_RATE_MAX      3.0f        /* the output moves at most this fast, units: m/s */
+
+/* ----------------------------------------------------------
+ *
+ * echoes out of range are not put into the window. the output
+ * is the median of the last SONAR_MEDIAN_N echoes, and moves
+ * at most SONAR_RATE_MAX from the last valid output, so one
+ * spurious echo is dropped and a few can only nudge it.
+ * a run of misses as long as the median can outvote starts
+ * the window afresh.
+ *
+ * --------------------------------------------------------*/
+typedef enum {
+    SONAR_FILTER_FILL,          /* in range, the window is not full yet. */
+    SONAR_FILTER_VALID,
+    SONAR_FILTER_LIMITED,       /* valid, moved at SONAR_RATE_MAX. */
+    SONAR_FILTER_RANGE,         /* out of range, taken as a miss. */
+} sonar_filter_e;
+
+struct sonar_filter {
+    uint16_t window[SONAR_MEDIAN_N];    /* units: counts */
+    uint8_t  idx;
+    uint8_t  num;
+    uint8_t  misses;
+    bool     last_valid;
+    float    last_height;               /* units: m */
+    uint32_t last_us;
+};
+
+extern void sonar_filter_init(struct sonar_filter *sf);
+extern sonar_filter_e sonar_filter_echo(struct sonar_filter *sf, uint16_t count, uint32_t t_us,
+                                        float *height);
+extern float sonar_filter_miss(struct sonar_filter *sf);
+
+#endif /* TOOLS_SONAR_FILTER_H_ */
@@ -0,0 +1,98 @@
+/*
+ * target_tracker.c
+ */
+
+/* User include files. */
+#include "target_tracker.h"
+
+/*-----------------------------------------------------------*/
+/* private functions declaration. */
+static float tracker_clamp(float v, float max);
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void tracker_init(struct target_tracker *tr, float alpha, float beta, float w, float h)
+{
+    tr->alpha = alpha;
+    tr->beta  = beta;
+    tr->w     = w;
+    tr->h     = h;
+    tracker_reset(tr);
+}
+
+void tracker_reset(struct target_tracker *tr)
+{
+    tr->x       = 0.0f;
+    tr->y       = 0.0f;
+    tr->vx      = 0.0f;
+    tr->vy      = 0.0f;
+    tr->t_us    = 0;
+    tr->started = false;
+}
+
+/* ----------------------------------------------------------
+ *
+ * corrects the estimate with a measurement taken at t_us.
+ * the first measurement, or one after a long gap, restarts
+ * the tracker at the measured position with zero velocity.
+ *
+ * --------------------------------------------------------*/
+void tracker_update(struct target_tracker *tr, float mx, float my, uint32_t t_us)
+{
+    uint32_t dt_us = t_us - tr->t_us;
+    float dt, rx, ry;
+
+    if (!tr->started || dt_us == 0 || dt_us > TRACKER_MAX_DT_MS * 1000UL) {
+        tr->x       = mx;
+        tr->y       = my;
+        tr->vx      = 0.0f;
+        tr->vy      = 0.0f;
+        tr->t_us    = t_us;
+        tr->started = true;
+        return;
+    }
+
+    dt = (float)dt_us * 1e-6f;
+    /* residual against the prediction for this instant. */
+    rx = mx - (tr->x + tr->vx * dt);
+    ry = my - (tr->y + tr->vy * dt);
+
+    tr->x  += tr->vx * dt + tr->alpha * rx;
+    tr->y  += tr->vy * dt + tr->alpha * ry;
+    tr->vx += tr->beta * rx / dt;
+    tr->vy += tr->beta * ry / dt;
+    tr->t_us = t_us;
+}
+
+/* ----------------------------------------------------------
+ *
+ * extrapolates the estimate to t_us. returns false if the
+ * tracker has not got any measurement yet.
+ *
+ * --------------------------------------------------------*/
+bool tracker_predict(const struct target_tracker *tr, uint32_t t_us, float *x, float *y)
+{
+    int32_t dt_us;
+    float dt;
+
+    if (!tr->started) return false;
+
+    dt_us = (int32_t)(t_us - tr->t_us);
+    if (dt_us < 0) dt_us = 0;
+    if (dt_us > TRACKER_MAX_PREDICT_MS * 1000L) dt_us = TRACKER_MAX_PREDICT_MS * 1000L;
+    dt = (float)dt_us * 1e-6f;
+
+    *x = tracker_clamp(tr->x + tr->vx * dt, tr->w - 1.0f);
+    *y = tracker_clamp(tr->y + tr->vy * dt, tr->h - 1.0f);
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+/* private functions definition. */
+static float tracker_clamp(float v, float max)
+{
+    if (v < 0.0f) return 0.0f;
+    if (v > max) return max;
+    return v;
+}
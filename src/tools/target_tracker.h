@@ -0,0 +1,41 @@
+/*
+ * target_tracker.h
+ */
+
+#ifndef TOOLS_TARGET_TRACKER_H_
+#define TOOLS_TARGET_TRACKER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACKER_DEFAULT_ALPHA   0.6f
+#define TRACKER_DEFAULT_BETA    0.2f
+#define TRACKER_MAX_DT_MS       300     /* longer gaps restart the tracker. */
+#define TRACKER_MAX_PREDICT_MS  150     /* extrapolation is limited to this. */
+
+/* ----------------------------------------------------------
+ *
+ * alpha-beta tracker of the target in image space, one per
+ * camera stream. units: pixel, pixel/s & us, times are
+ * timestamp_us() values & may wrap.
+ *
+ * --------------------------------------------------------*/
+struct target_tracker {
+    float alpha;
+    float beta;
+    float x;
+    float y;
+    float vx;
+    float vy;
+    float w;            /* image size, predictions are kept inside. */
+    float h;
+    uint32_t t_us;      /* time the estimate belongs to. */
+    bool started;
+};
+
+extern void tracker_init(struct target_tracker *tr, float alpha, float beta, float w, float h);
+extern void tracker_reset(struct target_tracker *tr);
+extern void tracker_update(struct target_tracker *tr, float mx, float my, uint32_t t_us);
+extern bool tracker_predict(const struct target_tracker *tr, uint32_t t_us, float *x, float *y);
+
+#endif /* TOOLS_TARGET_TRACKER_H_ */
@@ -0,0 +1,41 @@
+/*
+ * timestamp.c
+ */
+
+/* RTOS & rx23t include files. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform.h"
+
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "timestamp.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+/* ----------------------------------------------------------
+ *
+ * free running microsecond time, made of the tick count and
+ * the tick timer counter, wraps after about 71 minutes.
+ * can be called from tasks and from any interrupt. the ipl is
+ * only raised to configMAX_SYSCALL_INTERRUPT_PRIORITY, never
+ * lowered, so an interrupt above it, like the level 15 TMR0,
+ * is not nested into while it reads.
+ *
+ * --------------------------------------------------------*/
+uint32_t timestamp_us(void)
+{
+    signed long ipl = get_ipl();
+    uint32_t ticks;
+    uint16_t cnt;
+
+    if (ipl < configMAX_SYSCALL_INTERRUPT_PRIORITY) set_ipl(configMAX_SYSCALL_INTERRUPT_PRIORITY);
+    ticks = xTaskGetTickCountFromISR();
+    cnt = CMT0.CMCNT;
+    /* the counter has wrapped, but the tick interrupt has not run yet. */
+    if (IR(CMT0, CMI0) && cnt < TIMESTAMP_CNT_PER_TICK / 2) ticks++;
+    set_ipl(ipl);
+
+    return ticks * TIMESTAMP_US_PER_TICK + cnt / TIMESTAMP_CNT_PER_US;
+}
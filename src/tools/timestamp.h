@@ -0,0 +1,17 @@
+/*
+ * timestamp.h
+ */
+
+#ifndef TOOLS_TIMESTAMP_H_
+#define TOOLS_TIMESTAMP_H_
+
+#include <stdint.h>
+
+/* CMT0 is the RTOS tick timer, it counts PCLK/8. */
+#define TIMESTAMP_CNT_PER_US    (configPERIPHERAL_CLOCK_HZ / 8 / 1000000)
+#define TIMESTAMP_CNT_PER_TICK  (configPERIPHERAL_CLOCK_HZ / 8 / configTICK_RATE_HZ)
+#define TIMESTAMP_US_PER_TICK   (1000000 / configTICK_RATE_HZ)
+
+extern uint32_t timestamp_us(void);
+
+#endif /* TOOLS_TIMESTAMP_H_ */
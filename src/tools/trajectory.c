@@ -0,0 +1,64 @@
+/*
+ * trajectory.c
+ */
+
+#include <math.h>
+/*-----------------------------------------------------------*/
+/* User include files. */
+#include "trajectory.h"
+
+/*-----------------------------------------------------------*/
+/* global functions definition. */
+
+void trajectory_init(struct trajectory *tr, float pos, float v_max, float a_max)
+{
+    tr->pos    = pos;
+    tr->vel    = 0.0f;
+    tr->target = pos;
+    tr->v_max  = v_max;
+    tr->a_max  = a_max;
+    tr->done   = true;
+}
+
+void trajectory_set_target(struct trajectory *tr, float target)
+{
+    tr->target = target;
+    tr->done   = false;
+}
+
+void trajectory_step(struct trajectory *tr, float dt)
+{
+    float d = tr->target - tr->pos;
+    float dir = (d >= 0.0f) ? 1.0f : -1.0f;
+    float dv = tr->a_max * dt;
+    float v = tr->vel * dir;    /* speed toward the target. */
+
+    if (tr->done) return;
+    if (fabsf(d) < 1e-3f && fabsf(tr->vel) <= dv) {
+        tr->pos  = tr->target;
+        tr->vel  = 0.0f;
+        tr->done = true;
+        return;
+    }
+
+    if (v < 0.0f) {
+        /* moving away, turn around. */
+        v += dv;
+    } else {
+        /* at most the speed that still stops on the target when
+         * braking by dv a step: v * (v + dv) = 2 * a_max * d. */
+        float v_stop = 0.5f * (sqrtf(dv * dv + 8.0f * tr->a_max * fabsf(d)) - dv);
+
+        v += dv;
+        if (v > tr->v_max) v = tr->v_max;
+        if (v > v_stop) v = v_stop;
+    }
+
+    tr->vel = v * dir;
+    tr->pos += tr->vel * dt;
+    if ((tr->target - tr->pos) * dir <= 0.0f) {
+        tr->pos  = tr->target;
+        tr->vel  = 0.0f;
+        tr->done = true;
+    }
+}
@@ -0,0 +1,31 @@
+/*
+ * trajectory.h
+ */
+
+#ifndef TOOLS_TRAJECTORY_H_
+#define TOOLS_TRAJECTORY_H_
+
+#include <stdbool.h>
+
+/* ----------------------------------------------------------
+ *
+ * one dimensional trapezoidal velocity profile, stepped by
+ * the control loop that follows it. it accelerates to v_max,
+ * cruises, and brakes at a_max to stop on the target. a new
+ * target may be set at any time, the velocity stays smooth.
+ *
+ * --------------------------------------------------------*/
+struct trajectory {
+    float pos;
+    float vel;
+    float target;
+    float v_max;
+    float a_max;
+    bool  done;
+};
+
+extern void trajectory_init(struct trajectory *tr, float pos, float v_max, float a_max);
+extern void trajectory_set_target(struct trajectory *tr, float target);
+extern void trajectory_step(struct trajectory *tr, float dt);
+
+#endif /* TOOLS_TRAJECTORY_H_ */
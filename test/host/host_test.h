@@ -0,0 +1,57 @@
+/*
+ * host_test.h
+ */
+
+#ifndef TEST_HOST_TEST_H_
+#define TEST_HOST_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+/* ----------------------------------------------------------
+ *
+ * checks for the host tests of the plain C modules in
+ * src/tools. a failed check is printed & counted, the test
+ * goes on, HOST_TEST_END() returns the exit code of main().
+ *
+ * --------------------------------------------------------*/
+static int host_test_failed = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failed++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol) do { \
+        double a_ = (a), b_ = (b); \
+        if (!(fabs(a_ - b_) <= (tol))) { \
+            printf("%s:%d: CHECK_NEAR(%s, %s) failed, %g != %g\n", \
+                   __FILE__, __LINE__, #a, #b, a_, b_); \
+            host_test_failed++; \
+        } \
+    } while (0)
+
+/* ----------------------------------------------------------
+ *
+ * monotonic host time for the benchmarks. the numbers are
+ * host ns, they only compare versions of the same code, the
+ * target is slower by a factor which is not measured here.
+ *
+ * --------------------------------------------------------*/
+static inline uint64_t host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#define HOST_TEST_END() do { \
+        printf("%s: %s\n", __FILE__, host_test_failed ? "FAILED" : "ok"); \
+        return host_test_failed ? 1 : 0; \
+    } while (0)
+
+#endif /* TEST_HOST_TEST_H_ */
@@ -0,0 +1,330 @@
+/*
+ * serial_replay.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "serial_capture.h"
+#include "byte_ring.h"
+#include "cam_frame.h"
+#include "cam_commu.h"
+#include "car_cmd.h"
+
+/* ----------------------------------------------------------
+ *
+ * replays a serial capture, the SCAP dump serial_capture_dump()
+ * prints on KEY_LEFT, through the parsers the firmware runs:
+ * cam_frame.c for SCI1 & car_cmd.c for SCI5.
+ *  ./serial_replay [-1] [-w <us>] <dump>
+ * -1 replays at the captured speed, sleeping out the gaps,
+ * otherwise as fast as possible. text around the SCAP blocks
+ * is skipped, several blocks are replayed back to back.
+ * reported are the parser throughput, frame counts and the
+ * latency from the STX of each camera frame to its decode:
+ * "wire" in capture time, "host" in replay time, which is
+ * the wire time plus the parse cost with -1.
+ * the camera bytes are then replayed once more the way the
+ * firmware receives them, in capture time: into a byte ring
+ * of CAM_RX_RING_SIZE, with cam_track_byte() waking the task
+ * -w us after a frame end (default 0), or at its timeouts.
+ * the task drains the ring in CAM_RX_BATCH batches. reported
+ * are the bytes/s the host sustains through ring & parser,
+ * the bytes the ring dropped, and the latency to the drain.
+ *
+ * --------------------------------------------------------*/
+struct record {
+    uint64_t t_us;          /* capture time of the byte. */
+    uint8_t  port;
+    uint8_t  byte;
+};
+
+struct latency {
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint32_t num;
+};
+
+static struct record *recs;
+static size_t rec_num, rec_cap;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void latency_add(struct latency *l, uint64_t v)
+{
+    if (l->num == 0 || v < l->min) l->min = v;
+    if (v > l->max) l->max = v;
+    l->sum += v;
+    l->num++;
+}
+
+static void latency_print(const char *name, const struct latency *l, double scale, const char *unit)
+{
+    if (l->num == 0) return;
+    printf("  %s latency min %.1f avg %.1f max %.1f %s\n", name, l->min * scale,
+           (double)l->sum / l->num * scale, l->max * scale, unit);
+}
+
+static void rec_add(uint64_t t_us, uint8_t port, uint8_t byte)
+{
+    if (rec_num == rec_cap) {
+        rec_cap = rec_cap ? rec_cap * 2 : 4096;
+        recs = realloc(recs, rec_cap * sizeof(*recs));
+        if (recs == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    recs[rec_num].t_us = t_us;
+    recs[rec_num].port = port;
+    recs[rec_num].byte = byte;
+    rec_num++;
+}
+
+/* reads every SCAP block of the dump, returns false on a malformed one. */
+static bool dump_read(FILE *fp)
+{
+    char tok[64];
+    uint64_t t_us = 0;
+    int version, num, overwritten, blocks = 0;
+    unsigned long v;
+    char *end;
+
+    while (fscanf(fp, "%63s", tok) == 1) {
+        if (strcmp(tok, "SCAP") != 0) continue;
+        if (fscanf(fp, "%d %d %d", &version, &num, &overwritten) != 3
+            || version < 1 || version > SERIAL_CAPTURE_VERSION) {
+            fprintf(stderr, "bad SCAP header\n");
+            return false;
+        }
+        if (overwritten) fprintf(stderr, "block %d: %d records were overwritten before the dump\n", blocks, overwritten);
+        for (int i = 0; i < num; i++) {
+            if (fscanf(fp, "%63s", tok) != 1 || strlen(tok) != 8) {
+                fprintf(stderr, "block %d: record %d is missing\n", blocks, i);
+                return false;
+            }
+            v = strtoul(tok, &end, 16);
+            if (*end != '\0') {
+                fprintf(stderr, "block %d: record %d is not hex\n", blocks, i);
+                return false;
+            }
+            /* the bytes print in record order: dt low, dt high, port, byte. */
+            t_us += ((v >> 24) & 0xFF) | ((v >> 8) & 0xFF00);
+            if (((v >> 8) & 0xFF) == SERIAL_CAPTURE_GAP) {
+                t_us += (v & 0xFF) << 16;
+                continue;
+            }
+            rec_add(t_us, (uint8_t)(v >> 8), (uint8_t)v);
+        }
+        if (fscanf(fp, "%63s", tok) != 1 || strcmp(tok, "SCAP") != 0
+            || fscanf(fp, "%63s", tok) != 1 || strcmp(tok, "END") != 0) {
+            fprintf(stderr, "block %d: no SCAP END\n", blocks);
+            return false;
+        }
+        blocks++;
+    }
+    return blocks > 0;
+}
+
+#define TICK_US     (1000000u / configTICK_RATE_HZ)
+
+/* ----------------------------------------------------------
+ *
+ * the receive interrupt & cam_commu_task_entry() in capture
+ * time. the task runs at wake_at or timeout_at, and takes no
+ * time to drain the ring.
+ *
+ * --------------------------------------------------------*/
+static void replay_ring(uint32_t wake_us)
+{
+    static uint8_t ring_buf[CAM_RX_RING_SIZE];
+    static uint64_t ring_t[CAM_RX_RING_SIZE];   /* capture time of each queued byte. */
+    struct byte_ring ring;
+    struct cam_track track = { 0, 0 };
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct latency lat = { 0, 0, 0, 0 };
+    uint8_t batch[CAM_RX_BATCH];
+    uint64_t wake_at = UINT64_MAX, timeout_at, t_task, stx_t = 0, t0, t1;
+    uint32_t t_head = 0, t_tail = 0, bytes = 0, frames = 0, wakes = 0, timeouts = 0;
+    uint16_t n;
+
+    byte_ring_init(&ring, ring_buf, CAM_RX_RING_SIZE);
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    timeout_at = (rec_num ? recs[0].t_us : 0) + CAM_RX_TIMEOUT * TICK_US;
+
+    t0 = now_ns();
+    for (size_t i = 0; i <= rec_num; i++) {
+        uint64_t t = (i < rec_num) ? recs[i].t_us : UINT64_MAX;
+
+        /* the task runs every time it is due before this byte. */
+        while ((t_task = (wake_at < timeout_at) ? wake_at : timeout_at) <= t && t_task != UINT64_MAX) {
+            if (t_task == wake_at) wakes++;
+            else timeouts++;
+            while ((n = byte_ring_get(&ring, batch, CAM_RX_BATCH)) != 0) {
+                for (uint16_t k = 0; k < n; k++) {
+                    uint64_t bt = ring_t[t_tail++ & (CAM_RX_RING_SIZE - 1)];
+                    if (cam_parse_byte(&ps, batch[k], &f) == CAM_PARSE_FRAME) {
+                        frames++;
+                        latency_add(&lat, t_task - stx_t);
+                    }
+                    if (ps.state == CAM_PS_HEAD) stx_t = bt;
+                }
+            }
+            wake_at = UINT64_MAX;
+            timeout_at = t_task + ((ps.state == CAM_PS_IDLE) ? CAM_RX_TIMEOUT : CAM_RX_FRAME_TIMEOUT) * TICK_US;
+            if (i == rec_num) timeout_at = UINT64_MAX;
+        }
+        if (i == rec_num) break;
+        if (recs[i].port != SERIAL_PORT_CAM) continue;
+
+        bytes++;
+        if (byte_ring_put(&ring, recs[i].byte))
+            ring_t[t_head++ & (CAM_RX_RING_SIZE - 1)] = t;
+        if (cam_track_byte(&track, recs[i].byte) && wake_at == UINT64_MAX)
+            wake_at = t + wake_us;
+    }
+    t1 = now_ns();
+
+    printf("SCI1 ring of %d, task woken %u us after a frame end: %u frames, %u bytes dropped\n",
+           CAM_RX_RING_SIZE, (unsigned)wake_us, (unsigned)frames, (unsigned)ring.dropped);
+    printf("  %u wakes, %u timeouts, ring & parser %.0f bytes/s on the host\n",
+           (unsigned)wakes, (unsigned)timeouts, t1 > t0 ? bytes * 1e9 / (double)(t1 - t0) : 0.0);
+    latency_print("drain", &lat, 1.0, "us");
+}
+
+static void sleep_until(uint64_t start_ns, uint64_t t_us)
+{
+    uint64_t now = now_ns() - start_ns;
+    struct timespec ts;
+
+    if (now >= t_us * 1000) return;
+    ts.tv_sec = (time_t)((t_us * 1000 - now) / 1000000000u);
+    ts.tv_nsec = (long)((t_us * 1000 - now) % 1000000000u);
+    nanosleep(&ts, NULL);
+}
+
+/* the parse loop alone over the camera bytes, for the throughput. */
+static double cam_throughput(void)
+{
+    uint8_t *bytes = malloc(rec_num ? rec_num : 1);
+    struct cam_parser ps;
+    struct cam_frame f;
+    size_t n = 0;
+    uint64_t t0, t1;
+    int rounds = 0;
+
+    for (size_t i = 0; i < rec_num; i++) {
+        if (recs[i].port == SERIAL_PORT_CAM) bytes[n++] = recs[i].byte;
+    }
+    if (n == 0) {
+        free(bytes);
+        return 0;
+    }
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    t0 = now_ns();
+    /* short captures are repeated to get above the clock resolution. */
+    do {
+        for (size_t i = 0; i < n; i++)
+            cam_parse_byte(&ps, bytes[i], &f);
+        rounds++;
+        t1 = now_ns();
+    } while (t1 - t0 < 10000000u);
+    free(bytes);
+    return (double)n * rounds * 1000.0 / (double)(t1 - t0);
+}
+
+int main(int argc, char **argv)
+{
+    bool realtime = false;
+    uint32_t wake_us = 0;
+    const char *path = NULL;
+    FILE *fp;
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct latency wire = { 0, 0, 0, 0 }, host = { 0, 0, 0, 0 };
+    uint64_t cam_start_us = 0, cam_start_ns = 0, start_ns;
+    uint32_t bytes[SERIAL_PORT_NUM] = { 0, 0 };
+    uint32_t cam_ok = 0, cam_bad = 0, cam_dup = 0, car_ok = 0;
+    uint32_t car_cmds[256] = { 0 };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-1") == 0) realtime = true;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) wake_us = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else path = argv[i];
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [-1] [-w <us>] <dump>\n", argv[0]);
+        return 2;
+    }
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return 2;
+    }
+    if (!dump_read(fp)) {
+        fprintf(stderr, "%s: no readable SCAP block\n", path);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    start_ns = now_ns();
+    for (size_t i = 0; i < rec_num; i++) {
+        const struct record *r = &recs[i];
+
+        if (r->port >= SERIAL_PORT_NUM) continue;
+        if (realtime) sleep_until(start_ns, r->t_us - recs[0].t_us);
+        bytes[r->port]++;
+        if (r->port == SERIAL_PORT_CAR) {
+            if (car_cmd_known(r->byte)) {
+                car_ok++;
+                car_cmds[r->byte]++;
+            }
+            continue;
+        }
+        switch (cam_parse_byte(&ps, r->byte, &f)) {
+        case CAM_PARSE_FRAME:
+            cam_ok++;
+            latency_add(&wire, r->t_us - cam_start_us);
+            latency_add(&host, now_ns() - cam_start_ns);
+            break;
+        case CAM_PARSE_BAD: cam_bad++; break;
+        case CAM_PARSE_DUP: cam_dup++; break;
+        default: break;
+        }
+        /* only STX enters the head state. */
+        if (ps.state == CAM_PS_HEAD) {
+            cam_start_us = r->t_us;
+            cam_start_ns = now_ns();
+        }
+    }
+
+    printf("%s: %u records over %.3f s%s\n", path, (unsigned)rec_num,
+           rec_num ? (recs[rec_num - 1].t_us - recs[0].t_us) / 1e6 : 0.0, realtime ? ", replayed at 1x" : "");
+    printf("SCI1 camera: %u bytes, %u frames, %u rejected, %u duplicates\n",
+           (unsigned)bytes[SERIAL_PORT_CAM], (unsigned)cam_ok, (unsigned)cam_bad, (unsigned)cam_dup);
+    printf("  parser %.1f bytes/us on the host\n", cam_throughput());
+    latency_print("wire", &wire, 1.0, "us");
+    latency_print("host", &host, 1e-3, "us");
+    printf("SCI5 car: %u bytes, %u commands", (unsigned)bytes[SERIAL_PORT_CAR], (unsigned)car_ok);
+    for (int c = 0; c < 256; c++) {
+        if (car_cmds[c]) printf(" %02x:%u", c, (unsigned)car_cmds[c]);
+    }
+    printf("\n");
+    replay_ring(wake_us);
+    free(recs);
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * FreeRTOS.h
+ */
+
+#ifndef TEST_STUBS_FREERTOS_H_
+#define TEST_STUBS_FREERTOS_H_
+
+/* ----------------------------------------------------------
+ *
+ * just enough of the RTOS for the host harness of
+ * ppm_encoder.c & for the constants of the component headers.
+ * the harnesses run single threaded: there is no scheduler &
+ * a critical section is nothing.
+ *
+ * --------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+
+#define pdFALSE     0
+#define pdTRUE      1
+#define pdPASS      pdTRUE
+
+/* the values of r_config/FreeRTOSConfig.h */
+#define configCPU_CLOCK_HZ          (40000000UL)
+#define configPERIPHERAL_CLOCK_HZ   (40000000UL)
+#define configTICK_RATE_HZ          ((TickType_t)100)
+
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define configASSERT(x) assert(x)
+
+#endif /* TEST_STUBS_FREERTOS_H_ */
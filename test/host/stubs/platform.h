@@ -0,0 +1,57 @@
+/*
+ * platform.h
+ */
+
+#ifndef TEST_STUBS_PLATFORM_H_
+#define TEST_STUBS_PLATFORM_H_
+
+/* ----------------------------------------------------------
+ *
+ * the RX23T registers ppm_encoder.c touches, as plain memory
+ * the harness reads & writes. the interrupt controller macros
+ * all land on one dummy.
+ *
+ * --------------------------------------------------------*/
+#include <stdint.h>
+
+struct host_cmt_unit {
+    volatile uint16_t CMCNT;
+    volatile uint16_t CMCOR;
+    struct {
+        struct {
+            uint16_t CKS  : 2;
+            uint16_t CMIE : 1;
+        } BIT;
+    } CMCR;
+};
+
+struct host_cmt {
+    struct {
+        struct {
+            uint16_t STR2 : 1;
+            uint16_t STR3 : 1;
+        } BIT;
+    } CMSTR1;
+};
+
+struct host_system {
+    struct {
+        uint16_t WORD;
+    } PRCR;
+};
+
+extern struct host_cmt_unit CMT0;
+extern struct host_cmt_unit CMT2;
+extern struct host_cmt CMT;
+extern struct host_system SYSTEM;
+extern volatile uint8_t host_icu_dummy;
+
+#define MSTP(unit)          host_icu_dummy
+#define IR(unit, irq)       host_icu_dummy
+#define IPR(unit, irq)      host_icu_dummy
+#define IEN(unit, irq)      host_icu_dummy
+
+/* the CC-RX intrinsic, atomic on the target. */
+extern void xchg(signed long *a, signed long *b);
+
+#endif /* TEST_STUBS_PLATFORM_H_ */
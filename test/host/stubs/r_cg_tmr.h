@@ -0,0 +1,16 @@
+/*
+ * r_cg_tmr.h
+ */
+
+#ifndef TEST_STUBS_R_CG_TMR_H_
+#define TEST_STUBS_R_CG_TMR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the harness implements these as the virtual TMR0. */
+extern void R_TMR0_Start(void);
+extern void U_TMR0_SetCMPA(uint16_t compare_a_value);
+extern void U_TMR0_SetOUTA(bool is_high);
+
+#endif /* TEST_STUBS_R_CG_TMR_H_ */
@@ -0,0 +1,15 @@
+/*
+ * task.h
+ */
+
+#ifndef TEST_STUBS_TASK_H_
+#define TEST_STUBS_TASK_H_
+
+#include "FreeRTOS.h"
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define vTaskNotifyGiveFromISR(task, woken)     ((void)(task), (void)(woken))
+#define portYIELD_FROM_ISR(woken)               ((void)(woken))
+
+#endif /* TEST_STUBS_TASK_H_ */
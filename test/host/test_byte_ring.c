@@ -0,0 +1,69 @@
+/*
+ * test_byte_ring.c
+ */
+
+#include <stdint.h>
+#include "host_test.h"
+#include "byte_ring.h"
+
+static void test_order(void)
+{
+    struct byte_ring r;
+    uint8_t buf[8], out[8];
+    uint16_t n;
+
+    byte_ring_init(&r, buf, sizeof(buf));
+    CHECK(byte_ring_count(&r) == 0);
+    for (uint8_t i = 0; i < 5; i++) CHECK(byte_ring_put(&r, i));
+    CHECK(byte_ring_count(&r) == 5);
+
+    n = byte_ring_get(&r, out, 3);
+    CHECK(n == 3);
+    CHECK(out[0] == 0 && out[1] == 1 && out[2] == 2);
+    n = byte_ring_get(&r, out, sizeof(out));
+    CHECK(n == 2);
+    CHECK(out[0] == 3 && out[1] == 4);
+    CHECK(byte_ring_get(&r, out, sizeof(out)) == 0);
+}
+
+/* a full ring drops the new byte & keeps the old ones. */
+static void test_full(void)
+{
+    struct byte_ring r;
+    uint8_t buf[4], out[4];
+
+    byte_ring_init(&r, buf, sizeof(buf));
+    for (uint8_t i = 0; i < 4; i++) CHECK(byte_ring_put(&r, i));
+    CHECK(!byte_ring_put(&r, 9));
+    CHECK(r.dropped == 1);
+    CHECK(byte_ring_count(&r) == 4);
+    CHECK(byte_ring_get(&r, out, sizeof(out)) == 4);
+    CHECK(out[0] == 0 && out[3] == 3);
+}
+
+/* head & tail are free running, they wrap at 65536. */
+static void test_wrap(void)
+{
+    struct byte_ring r;
+    uint8_t buf[16], out[16];
+    uint8_t next_in = 0, next_out = 0;
+    uint16_t n;
+
+    byte_ring_init(&r, buf, sizeof(buf));
+    r.head = r.tail = 0xFFF8;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 11; i++) CHECK(byte_ring_put(&r, next_in++));
+        n = byte_ring_get(&r, out, sizeof(out));
+        CHECK(n == 11);
+        for (uint16_t i = 0; i < n; i++) CHECK(out[i] == next_out++);
+    }
+    CHECK(r.dropped == 0);
+}
+
+int main(void)
+{
+    test_order();
+    test_full();
+    test_wrap();
+    HOST_TEST_END();
+}
@@ -0,0 +1,517 @@
+/*
+ * test_cam_frame.c
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "host_test.h"
+#include "cam_frame.h"
+#include "crc8.h"
+
+#define BENCH_FRAMES    200000
+
+/* STX, version, len, payload, crc8 into buf, returns the length. */
+static int frame_build(uint8_t *buf, uint8_t version, const uint8_t *payload, uint8_t len)
+{
+    buf[0] = COMMUNI_STX;
+    buf[1] = version;
+    buf[2] = len;
+    memcpy(&buf[3], payload, len);
+    buf[3 + len] = crc8_calc(&buf[1], (uint16_t)(len + 2));
+    return len + 4;
+}
+
+static int v2_build(uint8_t *buf, uint8_t seq, uint8_t x, uint8_t y)
+{
+    const uint8_t p[CAM_V2_PAYLOAD_LEN] = { seq, 0x34, 0x12, x, y, 0x20, 0x01, 200 };
+    return frame_build(buf, CAM_FRAME_VER_2, p, sizeof(p));
+}
+
+/* v3 frame of n blobs, blob i is class cls[i] at (10 + i, 20 + i). */
+static int v3_build(uint8_t *buf, uint8_t seq, const uint8_t *cls, uint8_t n, uint8_t count, uint8_t mode)
+{
+    uint8_t p[CAM_V3_HEAD_LEN + (CAM_MAX_BLOBS + 1) * CAM_V3_BLOB_LEN + 1];
+    uint8_t len = CAM_V3_HEAD_LEN;
+
+    p[0] = seq;
+    p[1] = 0;
+    p[2] = 0;
+    p[3] = count;
+    for (uint8_t i = 0; i < n; i++) {
+        p[len++] = cls[i];
+        p[len++] = (uint8_t)(10 + i);
+        p[len++] = (uint8_t)(20 + i);
+        p[len++] = (uint8_t)(i + 1);
+        p[len++] = 0;
+        p[len++] = 100;
+    }
+    if (mode != CAM_MODE_UNKNOWN) p[len++] = mode;
+    return frame_build(buf, CAM_FRAME_VER_3, p, len);
+}
+
+/* feeds n bytes, counts the results & keeps the last frame. */
+struct feed_result {
+    int frames;
+    int bad;
+    int dup;
+};
+
+static struct feed_result feed(struct cam_parser *ps, const uint8_t *buf, int n, struct cam_frame *f)
+{
+    struct feed_result r = { 0, 0, 0 };
+
+    for (int i = 0; i < n; i++) {
+        switch (cam_parse_byte(ps, buf[i], f)) {
+        case CAM_PARSE_FRAME: r.frames++; break;
+        case CAM_PARSE_BAD:   r.bad++;    break;
+        case CAM_PARSE_DUP:   r.dup++;    break;
+        default: break;
+        }
+    }
+    return r;
+}
+
+static void test_legacy(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    const uint8_t ok[] = { 0x00, COMMUNI_STX, 10, 20, COMMUNI_STX, 159, 119 };
+    const uint8_t bad[] = { COMMUNI_STX, 10, CAMERA_H };
+    const uint8_t restart[] = { COMMUNI_STX, 10, COMMUNI_STX, 30, 40 };
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    r = feed(&ps, ok, sizeof(ok), &f);
+    CHECK(r.frames == 2 && r.bad == 0);
+    CHECK(f.version == 1 && f.mode == CAM_MODE_UNKNOWN && f.blob_num == 1);
+    CHECK(f.blob[0].x == 159 && f.blob[0].y == 119);
+    CHECK(f.blob[0].cls == CAM_CLASS_LINE);
+
+    /* the class follows the mode selected by the port. */
+    ps.mode = CAM_MODE_GREEN;
+    r = feed(&ps, ok, 4, &f);
+    CHECK(r.frames == 1 && f.blob[0].cls == CAM_CLASS_CAR);
+
+    r = feed(&ps, bad, sizeof(bad), &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+
+    /* STX in place of y starts a new frame. */
+    r = feed(&ps, restart, sizeof(restart), &f);
+    CHECK(r.frames == 1 && r.bad == 0);
+    CHECK(f.blob[0].x == 30 && f.blob[0].y == 40);
+}
+
+static void test_v2(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    const uint8_t moded[] = { 7, 0, 0, 50, 60, 0, 0, 0, CAM_MODE_GREEN };
+    int n;
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    n = v2_build(buf, 1, 100, 80);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.bad == 0);
+    CHECK(f.version == CAM_FRAME_VER_2 && f.seq == 1 && f.timestamp == 0x1234);
+    CHECK(f.blob_num == 1 && f.blob[0].x == 100 && f.blob[0].y == 80);
+    CHECK(f.blob[0].area == 0x120 && f.blob[0].confidence == 200);
+    CHECK(f.mode == CAM_MODE_UNKNOWN && f.blob[0].cls == CAM_CLASS_LINE);
+
+    /* a trailing mode byte sets the mode & the class. */
+    n = frame_build(buf, CAM_FRAME_VER_2, moded, sizeof(moded));
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && f.mode == CAM_MODE_GREEN && f.blob[0].cls == CAM_CLASS_CAR);
+
+    /* out of the image. */
+    n = v2_build(buf, 2, CAMERA_W, 80);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+
+    /* a payload shorter than v2 needs. */
+    n = frame_build(buf, CAM_FRAME_VER_2, moded, CAM_V2_PAYLOAD_LEN - 1);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+
+    /* a length over the buffer is rejected at the len byte. */
+    buf[0] = COMMUNI_STX;
+    buf[1] = CAM_FRAME_VER_2;
+    buf[2] = CAM_MAX_PAYLOAD_LEN + 1;
+    r = feed(&ps, buf, 3, &f);
+    CHECK(r.bad == 1 && ps.state == CAM_PS_IDLE);
+}
+
+static void test_bad_crc(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    int n;
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    n = v2_build(buf, 1, 100, 80);
+    for (int i = 1; i < n; i++) {
+        buf[i] ^= 0x01;
+        r = feed(&ps, buf, n, &f);
+        /* a bad version or len byte may not even look like a v2 frame. */
+        CHECK(r.frames == 0);
+        buf[i] ^= 0x01;
+        ps.state = CAM_PS_IDLE;
+    }
+    n = v2_build(buf, 1, 100, 80);
+    buf[n - 1] ^= 0x80;
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+    /* the next good frame still goes through. */
+    n = v2_build(buf, 2, 100, 80);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.bad == 0);
+}
+
+/* STX as payload & crc byte, it does not restart the frame. */
+static void test_stx_in_payload(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    uint8_t p[CAM_V2_PAYLOAD_LEN] = { COMMUNI_STX, COMMUNI_STX, 0, 10, 20, COMMUNI_STX, 0, COMMUNI_STX };
+    int n, found = 0;
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    n = frame_build(buf, CAM_FRAME_VER_2, p, sizeof(p));
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.bad == 0);
+    CHECK(f.seq == COMMUNI_STX && f.blob[0].confidence == COMMUNI_STX);
+
+    /* find a payload whose crc is STX. */
+    for (int t = 0; t < 256 && !found; t++) {
+        p[0] = (uint8_t)t;
+        n = frame_build(buf, CAM_FRAME_VER_2, p, sizeof(p));
+        found = buf[n - 1] == COMMUNI_STX;
+    }
+    CHECK(found);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.bad == 0);
+}
+
+/* a frame cut short is caught by the crc of the bytes after it. */
+static void test_truncated(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    int n, m;
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    for (int cut = 1; cut < 12; cut++) {
+        v2_build(buf, 1, 100, 80);
+        m = v2_build(&buf[cut], 2, 101, 81);
+        r = feed(&ps, buf, cut + m, &f);
+        CHECK(r.frames <= 1);
+        if (r.frames) CHECK(f.seq == 2 && f.blob[0].x == 101);
+        /* whatever was eaten, the parser is in step again after a frame. */
+        m = v2_build(buf, (uint8_t)(10 + cut), 102, 82);
+        r = feed(&ps, buf, m, &f);
+        CHECK(r.frames == 1 && f.blob[0].x == 102);
+    }
+
+    /* a cut legacy frame followed by a v2 frame. */
+    buf[0] = COMMUNI_STX;
+    buf[1] = 10;
+    n = v2_build(&buf[2], 40, 103, 83);
+    r = feed(&ps, buf, n + 2, &f);
+    CHECK(r.frames == 1 && f.seq == 40);
+}
+
+static void test_dup(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    const uint8_t legacy[] = { COMMUNI_STX, 10, 20 };
+    int n;
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    n = v2_build(buf, 5, 100, 80);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.dup == 1);
+    n = v2_build(buf, 6, 100, 80);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.dup == 0);
+
+    /* legacy frames are never duplicates, and break the run. */
+    r = feed(&ps, legacy, sizeof(legacy), &f);
+    r = feed(&ps, legacy, sizeof(legacy), &f);
+    CHECK(r.frames == 1 && r.dup == 0);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && r.dup == 0);
+}
+
+static void test_v3(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint8_t buf[64];
+    const uint8_t cls[CAM_MAX_BLOBS + 1] = { CAM_CLASS_CAR, CAM_CLASS_LINE, CAM_CLASS_CAR, CAM_CLASS_LINE, CAM_CLASS_CAR };
+    const uint8_t unknown[2] = { CAM_CLASS_NUM, CAM_CLASS_CAR };
+    uint8_t seq = 0;
+    int n;
+
+    cam_parser_init(&ps, CAM_MODE_GREEN);
+    for (uint8_t k = 0; k <= CAM_MAX_BLOBS; k++) {
+        n = v3_build(buf, seq++, cls, k, k, CAM_MODE_UNKNOWN);
+        r = feed(&ps, buf, n, &f);
+        CHECK(r.frames == 1 && r.bad == 0);
+        CHECK(f.version == CAM_FRAME_VER_3 && f.blob_num == k && f.mode == CAM_MODE_UNKNOWN);
+        for (uint8_t i = 0; i < k; i++) {
+            CHECK(f.blob[i].cls == cls[i]);
+            CHECK(f.blob[i].x == 10 + i && f.blob[i].y == 20 + i);
+            CHECK(f.blob[i].area == i + 1 && f.blob[i].confidence == 100);
+        }
+    }
+
+    /* the trailing mode byte. */
+    n = v3_build(buf, seq++, cls, 2, 2, CAM_MODE_BLACK);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && f.blob_num == 2 && f.mode == CAM_MODE_BLACK);
+
+    /* more blobs than the table holds, a count over CAM_MAX_BLOBS
+     * is rejected even if the payload fits. */
+    n = v3_build(buf, seq++, cls, CAM_MAX_BLOBS + 1, CAM_MAX_BLOBS + 1, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+    n = v3_build(buf, seq++, cls, CAM_MAX_BLOBS, CAM_MAX_BLOBS + 1, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+
+    /* a class this side does not know is skipped, the rest is kept. */
+    n = v3_build(buf, seq++, unknown, 2, 2, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && f.blob_num == 1 && f.blob[0].cls == CAM_CLASS_CAR && f.blob[0].x == 11);
+
+    /* a count the length cannot hold. */
+    n = v3_build(buf, seq++, cls, 2, 3, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+    n = v3_build(buf, seq++, cls, 0, 1, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+
+    /* a length with bytes to spare reads the first spare as mode. */
+    n = v3_build(buf, seq++, cls, 2, 1, CAM_MODE_UNKNOWN);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 1 && f.blob_num == 1 && f.mode == cls[1]);
+
+    /* a payload shorter than the v3 head. */
+    n = frame_build(buf, CAM_FRAME_VER_3, cls, CAM_V3_HEAD_LEN - 1);
+    r = feed(&ps, buf, n, &f);
+    CHECK(r.frames == 0 && r.bad == 1);
+}
+
+/* feeds n bytes to the tracker, returns the index of its last frame end, -1 if none. */
+static int track(struct cam_track *t, const uint8_t *buf, int n, int *ends)
+{
+    int last = -1;
+
+    for (int i = 0; i < n; i++) {
+        if (cam_track_byte(t, buf[i])) {
+            last = i;
+            (*ends)++;
+        }
+    }
+    return last;
+}
+
+/* the frame ends the receive interrupt wakes the parser task at. */
+static void test_track(void)
+{
+    struct cam_track t = { 0, 0 };
+    uint8_t buf[64];
+    const uint8_t legacy[] = { 0x00, COMMUNI_STX, 10, 20 };
+    const uint8_t cls[2] = { CAM_CLASS_LINE, CAM_CLASS_CAR };
+    int n, ends = 0;
+
+    CHECK(track(&t, legacy, sizeof(legacy), &ends) == 3 && ends == 1);
+    n = v2_build(buf, 1, 100, 80);
+    ends = 0;
+    CHECK(track(&t, buf, n, &ends) == n - 1 && ends == 1);
+    n = v3_build(buf, 2, cls, 2, 2, CAM_MODE_BLACK);
+    ends = 0;
+    CHECK(track(&t, buf, n, &ends) == n - 1 && ends == 1);
+
+    /* a corrupted len byte, the STX of the next frame resyncs. */
+    n = v2_build(buf, 3, 100, 80);
+    buf[2] = CAM_MAX_PAYLOAD_LEN;
+    ends = 0;
+    CHECK(track(&t, buf, n, &ends) == -1);
+    n = v2_build(buf, 4, 100, 80);
+    CHECK(track(&t, buf, n, &ends) == n - 1 && ends == 1);
+
+    /* a len over the maximum ends the frame at once, as the parser does. */
+    buf[2] = CAM_MAX_PAYLOAD_LEN + 1;
+    ends = 0;
+    CHECK(track(&t, buf, 3, &ends) == 2 && ends == 1);
+    t.bytes = 0;
+
+    /* STX as crc ends the frame, it is the last byte. */
+    for (int s = 0; s < 256; s++) {
+        n = v2_build(buf, (uint8_t)s, 100, 80);
+        if (buf[n - 1] == COMMUNI_STX) break;
+    }
+    CHECK(buf[n - 1] == COMMUNI_STX);
+    ends = 0;
+    CHECK(track(&t, buf, n, &ends) == n - 1 && ends == 1);
+}
+
+/* the lookups of cam_target_get(), on a table fed by frames. */
+static void test_table(void)
+{
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct cam_target table[CAM_CLASS_NUM];
+    uint8_t buf[64];
+    const uint8_t both[2] = { CAM_CLASS_LINE, CAM_CLASS_CAR };
+    const uint8_t car[1] = { CAM_CLASS_CAR };
+    int n;
+
+    memset(table, 0, sizeof(table));
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+
+    n = v3_build(buf, 1, both, 2, 2, CAM_MODE_UNKNOWN);
+    feed(&ps, buf, n, &f);
+    cam_table_update(table, &f, 1, 100, 1000000);
+    CHECK(cam_target_fresh(&table[CAM_CLASS_LINE], 100, 0));
+    CHECK(cam_target_fresh(&table[CAM_CLASS_CAR], 100, 0));
+    CHECK(table[CAM_CLASS_LINE].x == 10 && table[CAM_CLASS_CAR].x == 11);
+    CHECK(table[CAM_CLASS_CAR].frame_id == 1 && table[CAM_CLASS_CAR].rx_us == 1000000);
+
+    /* too old. */
+    CHECK(cam_target_fresh(&table[CAM_CLASS_CAR], 120, 20));
+    CHECK(!cam_target_fresh(&table[CAM_CLASS_CAR], 121, 20));
+
+    /* a v3 frame without the line takes it out of sight. */
+    n = v3_build(buf, 2, car, 1, 1, CAM_MODE_UNKNOWN);
+    feed(&ps, buf, n, &f);
+    cam_table_update(table, &f, 2, 110, 1100000);
+    CHECK(!cam_target_fresh(&table[CAM_CLASS_LINE], 110, 20));
+    CHECK(cam_target_fresh(&table[CAM_CLASS_CAR], 110, 20));
+    CHECK(table[CAM_CLASS_CAR].frame_id == 2);
+
+    /* a v2 frame only touches the class of the mode. */
+    n = v2_build(buf, 3, 50, 60);
+    feed(&ps, buf, n, &f);
+    cam_table_update(table, &f, 3, 120, 1200000);
+    CHECK(cam_target_fresh(&table[CAM_CLASS_LINE], 120, 20));
+    CHECK(cam_target_fresh(&table[CAM_CLASS_CAR], 120, 20));
+    CHECK(table[CAM_CLASS_LINE].x == 50 && table[CAM_CLASS_CAR].frame_id == 2);
+
+    /* the age is unsigned, the tick count may wrap. */
+    table[CAM_CLASS_CAR].rx_tick = 0xFFFFFFF0u;
+    CHECK(cam_target_fresh(&table[CAM_CLASS_CAR], 0x00000003u, 20));
+}
+
+/* ----------------------------------------------------------
+ *
+ * parse cost per byte over a stream of v2 frames with a
+ * legacy frame & a bad byte now and then.
+ *
+ * --------------------------------------------------------*/
+static void bench_parse(void)
+{
+    static uint8_t stream[BENCH_FRAMES * 12 + 16];
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct feed_result r;
+    uint64_t t0, t1;
+    int n = 0;
+
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        if (i % 10 == 9) {
+            stream[n++] = COMMUNI_STX;
+            stream[n++] = (uint8_t)(i % CAMERA_W);
+            stream[n++] = (uint8_t)(i % CAMERA_H);
+        } else {
+            n += v2_build(&stream[n], (uint8_t)i, (uint8_t)(i % CAMERA_W), (uint8_t)(i % CAMERA_H));
+        }
+        if (i % 100 == 0) stream[n++] = 0x55;
+    }
+
+    cam_parser_init(&ps, CAM_MODE_BLACK);
+    t0 = host_ns();
+    r = feed(&ps, stream, n, &f);
+    t1 = host_ns();
+    CHECK(r.frames == BENCH_FRAMES && r.bad == 0 && r.dup == 0);
+    printf("cam_parse_byte: %d bytes, %.1f bytes/us, %.2f ns/byte\n",
+           n, n * 1000.0 / (double)(t1 - t0), (double)(t1 - t0) / n);
+}
+
+/* ----------------------------------------------------------
+ *
+ * full v3 frames of CAM_MAX_BLOBS blobs, each parsed, written
+ * into the table & looked up per class, the way the camera
+ * task & its readers use them. the link limits the frame rate
+ * to 115200 / 10 / bytes per frame.
+ *
+ * --------------------------------------------------------*/
+static void bench_v3(void)
+{
+    static uint8_t stream[BENCH_FRAMES / 4 * 40];
+    const uint8_t cls[CAM_MAX_BLOBS] = { CAM_CLASS_CAR, CAM_CLASS_LINE, CAM_CLASS_CAR, CAM_CLASS_LINE };
+    struct cam_parser ps;
+    struct cam_frame f;
+    struct cam_target table[CAM_CLASS_NUM];
+    int frames = BENCH_FRAMES / 4, n = 0, len = 0, got = 0, fresh = 0;
+    uint64_t t0, t1, t2;
+    double link_fps;
+
+    memset(table, 0, sizeof(table));
+    for (int i = 0; i < frames; i++) {
+        len = v3_build(&stream[n], (uint8_t)i, cls, CAM_MAX_BLOBS, CAM_MAX_BLOBS, CAM_MODE_GREEN);
+        n += len;
+    }
+    link_fps = 115200.0 / 10 / len;
+
+    cam_parser_init(&ps, CAM_MODE_GREEN);
+    t0 = host_ns();
+    for (int i = 0; i < n; i++) {
+        if (cam_parse_byte(&ps, stream[i], &f) == CAM_PARSE_FRAME) {
+            cam_table_update(table, &f, (uint16_t)got, (uint32_t)got, 0);
+            got++;
+        }
+    }
+    t1 = host_ns();
+    for (int i = 0; i < frames; i++) {
+        for (int c = 0; c < CAM_CLASS_NUM; c++)
+            fresh += cam_target_fresh(&table[c], (uint32_t)(got - 1 + i % 40), 20);
+    }
+    t2 = host_ns();
+    CHECK(got == frames && fresh > 0);
+    printf("cam v3 %d blobs: %d bytes/frame, %.0f ns/frame parse+update, %.1f ns/lookup, "
+           "%.4f%% of the host at the link's %.0f frames/s\n",
+           CAM_MAX_BLOBS, len, (double)(t1 - t0) / frames, (double)(t2 - t1) / frames / CAM_CLASS_NUM,
+           (double)(t1 - t0) / frames * link_fps / 1e7, link_fps);
+}
+
+int main(void)
+{
+    test_legacy();
+    test_v2();
+    test_bad_crc();
+    test_stx_in_payload();
+    test_truncated();
+    test_dup();
+    test_v3();
+    test_table();
+    test_track();
+    bench_parse();
+    bench_v3();
+    HOST_TEST_END();
+}
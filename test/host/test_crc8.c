@@ -0,0 +1,39 @@
+/*
+ * test_crc8.c
+ */
+
+#include <stdint.h>
+#include "host_test.h"
+#include "crc8.h"
+
+/* the bitwise CRC-8 the table was generated from. */
+static uint8_t crc8_bitwise(uint8_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+int main(void)
+{
+    const uint8_t check[] = "123456789";
+    uint8_t crc;
+
+    /* the catalogue check value of CRC-8 (poly 0x07, init 0). */
+    CHECK(crc8_calc(check, 9) == 0xF4);
+    CHECK(crc8_calc(check, 0) == CRC8_INIT);
+
+    for (int b = 0; b < 256; b++) {
+        CHECK(crc8_update(0x00, (uint8_t)b) == crc8_bitwise(0x00, (uint8_t)b));
+        CHECK(crc8_update(0xA5, (uint8_t)b) == crc8_bitwise(0xA5, (uint8_t)b));
+    }
+
+    /* byte by byte as the frame parser does. */
+    crc = CRC8_INIT;
+    for (int i = 0; i < 9; i++) crc = crc8_update(crc, check[i]);
+    CHECK(crc == 0xF4);
+
+    HOST_TEST_END();
+}
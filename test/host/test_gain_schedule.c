@@ -0,0 +1,224 @@
+/*
+ * test_gain_schedule.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "gain_schedule.h"
+#include "pid_control.h"
+
+/* the shape of POS_GAIN_TABLE, pos_control.h needs the RTOS. */
+#define TEST_GAIN_TABLE(X) \
+    X(0.2f, 1.40f, 1.00f, 1.20f, 30.0f) \
+    X(0.8f, 1.00f, 1.00f, 1.00f, 25.0f) \
+    X(1.6f, 0.60f, 0.80f, 0.80f, 20.0f)
+
+static const struct gain_point table[] = {
+    TEST_GAIN_TABLE(GAIN_POINT)
+};
+
+/* POS_GAIN_TABLE & the POS_* base gains. */
+#define POS_GAIN_TABLE(X) \
+    X(0.2f, 1.40f, 1.00f, 1.20f, 30.0f) \
+    X(0.5f, 1.15f, 1.00f, 1.10f, 27.0f) \
+    X(0.8f, 1.00f, 1.00f, 1.00f, 25.0f) \
+    X(1.2f, 0.80f, 0.85f, 0.90f, 22.0f) \
+    X(1.6f, 0.65f, 0.70f, 0.80f, 20.0f)
+#define POS_KP          1.5f
+#define POS_KI          0.0f
+#define POS_KD          0.38f
+#define POS_OUT_MAX     25.0f
+#define POS_PID_FREQ    50
+
+static const struct gain_point pos_table[] = {
+    POS_GAIN_TABLE(GAIN_POINT)
+};
+#define POS_POINTS      (sizeof(pos_table) / sizeof(pos_table[0]))
+
+static void test_lookup(void)
+{
+    struct gain_schedule gs;
+    struct gain_point g;
+
+    gain_schedule_init(&gs, table, sizeof(table) / sizeof(table[0]));
+    CHECK(gs.num == 3);
+
+    /* outside the table the end points are held. */
+    gain_schedule_lookup(&gs, 0.0f, &g);
+    CHECK_NEAR(g.kp, 1.40f, 1e-6);
+    CHECK_NEAR(g.out_max, 30.0f, 1e-6);
+    CHECK_NEAR(g.h, 0.0f, 1e-6);
+    gain_schedule_lookup(&gs, 3.0f, &g);
+    CHECK_NEAR(g.kp, 0.60f, 1e-6);
+    CHECK_NEAR(g.ki, 0.80f, 1e-6);
+
+    /* on a breakpoint & half way between two. */
+    gain_schedule_lookup(&gs, 0.8f, &g);
+    CHECK_NEAR(g.kp, 1.00f, 1e-6);
+    gain_schedule_lookup(&gs, 0.5f, &g);
+    CHECK_NEAR(g.kp, 1.20f, 1e-5);
+    CHECK_NEAR(g.kd, 1.10f, 1e-5);
+    CHECK_NEAR(g.out_max, 27.5f, 1e-4);
+    gain_schedule_lookup(&gs, 1.2f, &g);
+    CHECK_NEAR(g.kp, 0.80f, 1e-5);
+    CHECK_NEAR(g.ki, 0.90f, 1e-5);
+
+    /* a single point is held everywhere. */
+    gain_schedule_init(&gs, table, 1);
+    gain_schedule_lookup(&gs, 1.0f, &g);
+    CHECK_NEAR(g.kp, 1.40f, 1e-6);
+}
+
+/* roughly normal, sigma 1. */
+static float noise(void)
+{
+    float s = 0.0f;
+
+    for (int i = 0; i < 12; i++) s += (float)rand() / (float)RAND_MAX;
+    return s - 6.0f;
+}
+
+static void pos_params(struct pid2_param *pp, const struct gain_point *g)
+{
+    pid2_param_init(pp);
+    pp->kp = POS_KP * g->kp;
+    pp->ki = POS_KI * g->ki;
+    pp->kd = POS_KD * g->kd;
+    pp->dt = 1.0f / POS_PID_FREQ;
+    pp->out_max = g->out_max;
+}
+
+/* ----------------------------------------------------------
+ *
+ * host cost of the position loop gains per cycle: a lookup, a
+ * full reconfiguration of the two axes as pos_gain_update()
+ * does when the height moved, and the check that skips it.
+ *
+ * --------------------------------------------------------*/
+#define COST_N      1000000
+
+static void bench_cost(void)
+{
+    struct gain_schedule gs;
+    struct gain_point g;
+    struct pid_bank bank;
+    struct pid2_param pp;
+    float h, sink = 0.0f, cfg_h = 0.0f;
+    int skipped = 0;
+    uint64_t t0, t1, t2, t3;
+
+    gain_schedule_init(&gs, pos_table, POS_POINTS);
+    pid_bank_init(&bank, 2);
+
+    t0 = host_ns();
+    for (int i = 0; i < COST_N; i++) {
+        gain_schedule_lookup(&gs, (float)(i & 1023) * 2e-3f, &g);
+        sink += g.kp;
+    }
+    t1 = host_ns();
+    for (int i = 0; i < COST_N; i++) {
+        gain_schedule_lookup(&gs, (float)(i & 1023) * 2e-3f, &g);
+        pos_params(&pp, &g);
+        pid_bank_configure(&bank, 0, &pp);
+        pid_bank_configure(&bank, 1, &pp);
+        sink += bank.kp[1];
+    }
+    t2 = host_ns();
+    for (int i = 0; i < COST_N; i++) {
+        h = (float)(i & 1023) * 2e-4f;
+        if (fabsf(h - cfg_h) <= 0.05f) {
+            skipped++;
+            continue;
+        }
+        cfg_h = h;
+    }
+    t3 = host_ns();
+
+    printf("gain schedule: lookup %.1f ns, lookup & configure 2 axes %.1f ns, "
+           "skip check %.1f ns, %.1f%% skipped climbing at 1cm/s\n",
+           (double)(t1 - t0) / COST_N, (double)(t2 - t1) / COST_N, (double)(t3 - t2) / COST_N,
+           100.0 * skipped / COST_N);
+    CHECK(sink == sink);
+}
+
+/* ----------------------------------------------------------
+ *
+ * a 30cm position step at each height of POS_GAIN_TABLE, with
+ * the scheduled gains & with the base gains. the copter
+ * velocity follows the output with a lag, v' = (K * u - v) / tau,
+ * and the camera sees 1 pixel of noise, 0.72cm per meter of
+ * height. reports the overshoot & the 2cm settle time without
+ * the noise, and the rms jitter of the output over the last 5s
+ * with it.
+ *
+ * --------------------------------------------------------*/
+#define STEP_N      (15 * POS_PID_FREQ)
+#define STEP_CM     30.0f
+#define PLANT_K     4.0f        /* units: cm/s per ppm us */
+#define PLANT_TAU   0.4f        /* units: s */
+#define NOISE_CM_M  0.72f
+
+/* the noise is given in cm, units: cm */
+static void step(const struct gain_point *g, float noise_cm, float *overshoot, float *settle,
+                 float *jitter)
+{
+    struct pid2_param pp;
+    struct pid2 c;
+    float x = 0.0f, v = 0.0f, u, peak = 0.0f, sum = 0.0f, sum2 = 0.0f;
+    int last_out = -1, n = 0;
+
+    pos_params(&pp, g);
+    pid2_configure(&c, &pp);
+    pid2_reset(&c);
+    srand(10);
+    for (int i = 0; i < STEP_N; i++) {
+        u = pid2_update(&c, STEP_CM, x + noise_cm * noise(), 0.0f);
+        v += (PLANT_K * u - v) / PLANT_TAU * pp.dt;
+        x += v * pp.dt;
+        if (x > peak) peak = x;
+        if (fabsf(x - STEP_CM) > 2.0f) last_out = i;
+        if (i >= STEP_N - 5 * POS_PID_FREQ) {
+            sum += u;
+            sum2 += u * u;
+            n++;
+        }
+    }
+    *overshoot = (peak > STEP_CM) ? 100.0f * (peak - STEP_CM) / STEP_CM : 0.0f;
+    *settle = (last_out < STEP_N - 1) ? (last_out + 1) * pp.dt : -1.0f;
+    *jitter = sqrtf(sum2 / n - (sum / n) * (sum / n));
+}
+
+static void bench_step(void)
+{
+    struct gain_schedule gs;
+    struct gain_point g;
+    const struct gain_point base = {0.0f, 1.0f, 1.0f, 1.0f, POS_OUT_MAX};
+    float os, st, jit, os_b, st_b, jit_b, unused;
+
+    gain_schedule_init(&gs, pos_table, POS_POINTS);
+    for (unsigned i = 0; i < POS_POINTS; i++) {
+        float h = pos_table[i].h;
+
+        gain_schedule_lookup(&gs, h, &g);
+        step(&g, 0.0f, &os, &st, &unused);
+        step(&g, NOISE_CM_M * h, &unused, &unused, &jit);
+        step(&base, 0.0f, &os_b, &st_b, &unused);
+        step(&base, NOISE_CM_M * h, &unused, &unused, &jit_b);
+        printf("  %.1fm: scheduled overshoot %4.1f%% settle %.2fs jitter %.2fus, "
+               "base overshoot %4.1f%% settle %.2fs jitter %.2fus\n",
+               h, os, st, jit, os_b, st_b, jit_b);
+        CHECK(st > 0.0f);
+        CHECK(st_b > 0.0f);
+    }
+}
+
+int main(void)
+{
+    test_lookup();
+    bench_cost();
+    printf("position step over height:\n");
+    bench_step();
+    HOST_TEST_END();
+}
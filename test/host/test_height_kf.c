@@ -0,0 +1,174 @@
+/*
+ * test_height_kf.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "height_kf.h"
+
+/* the HEIGHT_EST_* values, height_est.h needs the RTOS. */
+#define TAU         0.3f
+#define Q_H         0.002f
+#define Q_V         0.5f
+#define R           0.0004f
+#define GATE        4.0f
+#define MAX_REJECT  5
+#define DT          0.02f
+
+/* roughly normal, sigma 1. */
+static float noise(void)
+{
+    float s = 0.0f;
+
+    for (int i = 0; i < 12; i++) s += (float)rand() / (float)RAND_MAX;
+    return s - 6.0f;
+}
+
+/* a steady 0.5m/s climb measured with 2cm noise. */
+static void test_climb(void)
+{
+    struct height_kf kf;
+    float h = 0.3f;
+
+    height_kf_init(&kf, TAU, Q_H, Q_V, R, GATE, MAX_REJECT);
+    CHECK(height_kf_update(&kf, h));
+    CHECK_NEAR(kf.h, h, 1e-6);
+    for (int n = 0; n < 150; n++) {
+        height_kf_predict(&kf, 0.5f, DT);
+        h += 0.5f * DT;
+        height_kf_update(&kf, h + 0.02f * noise());
+    }
+    CHECK_NEAR(kf.h, h, 0.03);
+    CHECK_NEAR(kf.v, 0.5f, 0.1);
+    CHECK(kf.p_hh < R);
+}
+
+static void test_outliers(void)
+{
+    struct height_kf kf;
+
+    height_kf_init(&kf, TAU, Q_H, Q_V, R, GATE, MAX_REJECT);
+    height_kf_update(&kf, 1.0f);
+    for (int n = 0; n < 50; n++) {
+        height_kf_predict(&kf, 0.0f, DT);
+        height_kf_update(&kf, 1.0f);
+    }
+
+    /* a single echo off a table is rejected. */
+    height_kf_predict(&kf, 0.0f, DT);
+    CHECK(!height_kf_update(&kf, 0.3f));
+    CHECK_NEAR(kf.h, 1.0f, 1e-3);
+    height_kf_predict(&kf, 0.0f, DT);
+    CHECK(height_kf_update(&kf, 1.0f));
+
+    /* MAX_REJECT in a row move the filter to the new height. */
+    for (int n = 0; n < MAX_REJECT - 1; n++) {
+        height_kf_predict(&kf, 0.0f, DT);
+        CHECK(!height_kf_update(&kf, 2.0f));
+    }
+    height_kf_predict(&kf, 0.0f, DT);
+    CHECK(height_kf_update(&kf, 2.0f));
+    CHECK_NEAR(kf.h, 2.0f, 1e-6);
+    CHECK_NEAR(kf.v, 0.0f, 1e-6);
+}
+
+/* the prediction does not go below the ground. */
+static void test_ground(void)
+{
+    struct height_kf kf;
+
+    height_kf_init(&kf, TAU, Q_H, Q_V, R, GATE, MAX_REJECT);
+    height_kf_predict(&kf, -1.0f, DT);
+    CHECK(!kf.started);
+    height_kf_update(&kf, 0.05f);
+    for (int n = 0; n < 50; n++) height_kf_predict(&kf, -1.0f, DT);
+    CHECK(kf.h >= 0.0f);
+    CHECK(kf.v >= -0.1f);
+}
+
+/* ----------------------------------------------------------
+ *
+ * a flight of climbs, holds & descents: the true velocity
+ * follows the command with the model lag, the sonar measures
+ * the height with 2cm noise, 3% outliers & 2% lost echoes
+ * after the first second, the filter starts on its first echo.
+ * reports the rms error of the estimate & of the raw echoes
+ * against the truth, and the host cost of a predict & update.
+ *
+ * --------------------------------------------------------*/
+#define FLIGHT_N    30000       /* 10 minutes at 50Hz. */
+#define FLIGHT_RUNS 20
+
+static void bench_flight(void)
+{
+    static float z[FLIGHT_N], v_cmd[FLIGHT_N], truth[FLIGHT_N];
+    struct height_kf kf;
+    float h = 0.3f, v = 0.0f, cmd = 0.0f, e, sum_kf = 0.0f, sum_raw = 0.0f, max_kf = 0.0f;
+    int n_raw = 0, outliers = 0;
+    uint64_t t0, t1;
+
+    for (int n = 0; n < FLIGHT_N; n++) {
+        if (n % 250 == 0) {
+            int r = rand() % 3;
+            cmd = (r == 0) ? 0.0f : (r == 1) ? 0.5f : -0.5f;
+            if (h > 2.5f && cmd > 0.0f) cmd = -cmd;
+            if (h < 0.6f && cmd < 0.0f) cmd = -cmd;
+        }
+        v += (cmd - v) * DT / TAU;
+        h += v * DT;
+        v_cmd[n] = cmd;
+        truth[n] = h;
+        int r = (n < 50) ? 100 : rand() % 100;
+        if (r < 3) {
+            z[n] = 0.2f + 3.0f * (float)rand() / (float)RAND_MAX;
+            outliers++;
+        } else if (r < 5) {
+            z[n] = -1.0f;       /* lost. */
+        } else {
+            z[n] = h + 0.02f * noise();
+        }
+    }
+
+    height_kf_init(&kf, TAU, Q_H, Q_V, R, GATE, MAX_REJECT);
+    for (int n = 0; n < FLIGHT_N; n++) {
+        height_kf_predict(&kf, v_cmd[n], DT);
+        if (z[n] >= 0.0f) {
+            height_kf_update(&kf, z[n]);
+            e = z[n] - truth[n];
+            sum_raw += e * e;
+            n_raw++;
+        }
+        e = fabsf(kf.h - truth[n]);
+        sum_kf += e * e;
+        if (e > max_kf) max_kf = e;
+    }
+
+    t0 = host_ns();
+    for (int k = 0; k < FLIGHT_RUNS; k++) {
+        height_kf_init(&kf, TAU, Q_H, Q_V, R, GATE, MAX_REJECT);
+        for (int n = 0; n < FLIGHT_N; n++) {
+            height_kf_predict(&kf, v_cmd[n], DT);
+            if (z[n] >= 0.0f) height_kf_update(&kf, z[n]);
+        }
+    }
+    t1 = host_ns();
+
+    printf("height kf flight: %d samples, %d outliers, rms %.1f mm (raw %.1f mm), max %.1f mm, "
+           "%.1f ns/sample\n",
+           FLIGHT_N, outliers, 1000.0 * sqrt(sum_kf / FLIGHT_N), 1000.0 * sqrt(sum_raw / n_raw),
+           1000.0 * max_kf, (double)(t1 - t0) / (FLIGHT_RUNS * FLIGHT_N));
+    CHECK(sqrt(sum_kf / FLIGHT_N) < 0.02);
+    CHECK(sum_kf / FLIGHT_N < sum_raw / n_raw);
+}
+
+int main(void)
+{
+    srand(1);
+    test_climb();
+    test_outliers();
+    test_ground();
+    bench_flight();
+    HOST_TEST_END();
+}
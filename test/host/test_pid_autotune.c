@@ -0,0 +1,219 @@
+/*
+ * test_pid_autotune.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_test.h"
+#include "pid_autotune.h"
+#include "pid_control.h"
+
+#define DT_US       1000
+#define DELAY_N     200         /* 0.2s dead time in DT_US steps. */
+
+/* ----------------------------------------------------------
+ *
+ * relay on an integrator with dead time L: the limit cycle has
+ * period 4L and amplitude amp * L, so tu = 0.8s & ku = 4 /
+ * (pi * 0.2) for amp 1, a bit less with the hysteresis.
+ *
+ * --------------------------------------------------------*/
+static void run_integrator(uint32_t t0_us, struct pid_autotune *at)
+{
+    static float hist[DELAY_N];
+    uint32_t t_us = t0_us;
+    float y = 0.05f, u;
+    int k = 0;
+
+    for (int i = 0; i < DELAY_N; i++) hist[i] = 0.0f;
+    autotune_start(at, 1.0f, 0.01f, 4, t_us, 30000);
+    for (int n = 0; n < 30000 && at->state == AUTOTUNE_RUNNING; n++) {
+        u = autotune_update(at, -y, t_us);
+        /* y follows the output of DELAY_N steps ago. */
+        y += hist[k] * (float)DT_US * 1e-6f;
+        hist[k] = u;
+        k = (k + 1) % DELAY_N;
+        t_us += DT_US;
+    }
+}
+
+/* ----------------------------------------------------------
+ *
+ * the position loop end to end: the copter velocity follows
+ * the output with a lag, v' = (K * u - v) / tau, and the
+ * camera adds POS_CAM_LATENCY_MS, run at POS_PID_FREQ with the
+ * POS_TUNE_* relay. the plant K * e^(-L*s) / (s * (tau * s + 1))
+ * has its ultimate point where atan(w * tau) + w * L = pi / 2.
+ * the hysteresis lags the relay by asin(hyst / a), so the limit
+ * cycle sits that much short of it, where a = 4 * amp * |G| / pi.
+ * the tune is checked against that point & both are reported.
+ * the gains of each rule are then run on a 30cm step.
+ *
+ * --------------------------------------------------------*/
+#define POS_FREQ    50
+#define POS_AMP     10.0f       /* POS_TUNE_AMP, units: ppm us */
+#define POS_HYST    3.0f        /* POS_TUNE_HYST, units: cm */
+#define POS_LAT_N   2           /* POS_CAM_LATENCY_MS at POS_PID_FREQ. */
+#define PLANT_K     4.0f        /* units: cm/s per ppm us */
+#define PLANT_TAU   0.4f        /* units: s */
+#define STEP_N      (15 * POS_FREQ)
+
+struct plant {
+    float x;
+    float v;
+    float seen[POS_LAT_N];
+    int   k;
+};
+
+static void plant_reset(struct plant *p)
+{
+    p->x = p->v = 0.0f;
+    for (int i = 0; i < POS_LAT_N; i++) p->seen[i] = 0.0f;
+    p->k = 0;
+}
+
+/* steps the plant on u, returns what the camera reports now. */
+static float plant_step(struct plant *p, float u)
+{
+    float dt = 1.0f / POS_FREQ, y = p->seen[p->k];
+
+    p->v += (PLANT_K * u - p->v) / PLANT_TAU * dt;
+    p->x += p->v * dt;
+    p->seen[p->k] = p->x;
+    p->k = (p->k + 1) % POS_LAT_N;
+    return y;
+}
+
+static float plant_gain(float w)
+{
+    return PLANT_K / (w * sqrtf(1.0f + w * PLANT_TAU * w * PLANT_TAU));
+}
+
+/* the limit cycle amplitude of the relay at w, units: cm */
+static float relay_a(float w)
+{
+    return 4.0f * POS_AMP * plant_gain(w) / 3.14159265f;
+}
+
+/* lag of the plant beyond pi / 2 at w, plus that of the relay if
+ * hyst, which is all of pi / 2 while the cycle is within it. */
+static float loop_lag(float w, bool hyst)
+{
+    float lag = atanf(w * PLANT_TAU) + w * (float)POS_LAT_N / POS_FREQ;
+
+    if (hyst) lag += (relay_a(w) > POS_HYST) ? asinf(POS_HYST / relay_a(w)) : 1.57079633f;
+    return lag;
+}
+
+/* the frequency where the loop lags pi, the lag grows with w. */
+static float cycle_w(bool hyst)
+{
+    float lo = 0.0f, hi = 100.0f, w = 0.0f;
+
+    for (int i = 0; i < 60; i++) {
+        w = 0.5f * (lo + hi);
+        if (loop_lag(w, hyst) < 1.57079633f) lo = w;
+        else hi = w;
+    }
+    return w;
+}
+
+/* the ultimate point, & the one a relay with hysteresis finds. */
+static void ultimate(float *ku, float *tu, float *ku_relay, float *tu_relay)
+{
+    float w = cycle_w(false), a;
+
+    *ku = 1.0f / plant_gain(w);
+    *tu = 2.0f * 3.14159265f / w;
+    w = cycle_w(true);
+    a = relay_a(w);
+    *ku_relay = 4.0f * POS_AMP / (3.14159265f * sqrtf(a * a - POS_HYST * POS_HYST));
+    *tu_relay = 2.0f * 3.14159265f / w;
+}
+
+static void test_position(void)
+{
+    static const char *rule_name[AUTOTUNE_RULE_NUM] = {"ZN", "TL", "no overshoot"};
+    struct pid_autotune at;
+    struct plant p;
+    struct pid2_param pp;
+    struct pid2 c;
+    float ku, tu, ku_relay, tu_relay, y = 0.0f, u, kp, ki, kd, peak, settle;
+    uint32_t t_us = 0;
+    int last_out;
+
+    ultimate(&ku, &tu, &ku_relay, &tu_relay);
+    plant_reset(&p);
+    autotune_start(&at, POS_AMP, POS_HYST, 4, t_us, 30000);
+    while (at.state == AUTOTUNE_RUNNING) {
+        u = autotune_update(&at, 0.0f - y, t_us);
+        y = plant_step(&p, u);
+        t_us += 1000000 / POS_FREQ;
+    }
+    printf("position auto-tune: %s in %.1f s, ku %.3f tu %.3f s, "
+           "model with hysteresis ku %.3f tu %.3f s, ultimate ku %.3f tu %.3f s\n",
+           at.state == AUTOTUNE_DONE ? "done" : "failed", t_us * 1e-6, at.ku, at.tu,
+           ku_relay, tu_relay, ku, tu);
+    CHECK(at.state == AUTOTUNE_DONE);
+    CHECK_NEAR(at.ku, ku_relay, 0.1f * ku_relay);
+    CHECK_NEAR(at.tu, tu_relay, 0.1f * tu_relay);
+
+    for (int r = 0; r < AUTOTUNE_RULE_NUM; r++) {
+        CHECK(autotune_gains(&at, (autotune_rule_e)r, &kp, &ki, &kd));
+        pid2_param_init(&pp);
+        pp.kp = kp;
+        pp.ki = ki;
+        pp.kd = kd;
+        pp.dt = 1.0f / POS_FREQ;
+        pp.i_max = 15.0f;
+        pp.out_max = 25.0f;
+        pid2_configure(&c, &pp);
+        pid2_reset(&c);
+        plant_reset(&p);
+        y = peak = 0.0f;
+        last_out = -1;
+        for (int i = 0; i < STEP_N; i++) {
+            y = plant_step(&p, pid2_update(&c, 30.0f, y, 0.0f));
+            if (p.x > peak) peak = p.x;
+            if (fabsf(p.x - 30.0f) > 2.0f) last_out = i;
+        }
+        settle = (last_out < STEP_N - 1) ? (last_out + 1) * pp.dt : -1.0f;
+        printf("  %s: kp %.3f ki %.3f kd %.3f, step overshoot %.1f%% settle %.2f s\n",
+               rule_name[r], kp, ki, kd, peak > 30.0f ? 100.0f * (peak - 30.0f) / 30.0f : 0.0f, settle);
+        CHECK(settle > 0.0f);
+    }
+}
+
+int main(void)
+{
+    struct pid_autotune at, at_wrap;
+    uint32_t t0_us = 0xFFFFFFFFUL - 1000;
+    float kp, ki, kd;
+
+    run_integrator(1000000, &at);
+    CHECK(at.state == AUTOTUNE_DONE);
+    CHECK_NEAR(at.tu, 0.8f + 0.04f, 0.05f);
+    CHECK_NEAR(at.ku, 4.0f / (3.14159265f * 0.21f), 0.3f);
+
+    /* the same run across the wrap of timestamp_us(). */
+    run_integrator(0xFFFFFFFFUL - 500000, &at_wrap);
+    CHECK(at_wrap.state == AUTOTUNE_DONE);
+    CHECK_NEAR(at_wrap.tu, at.tu, 1e-6);
+    CHECK_NEAR(at_wrap.ku, at.ku, 1e-6);
+
+    CHECK(autotune_gains(&at, AUTOTUNE_RULE_ZN, &kp, &ki, &kd));
+    CHECK_NEAR(kp, 0.6f * at.ku, 1e-5);
+    CHECK_NEAR(ki, kp / (0.5f * at.tu), 1e-4);
+    CHECK_NEAR(kd, kp * 0.125f * at.tu, 1e-5);
+
+    /* no oscillation, the tune times out, also across the wrap. */
+    autotune_start(&at, 1.0f, 0.01f, 4, t0_us, 100);
+    CHECK(autotune_update(&at, 0.0f, t0_us + 50000) > 0.0f);
+    CHECK(at.state == AUTOTUNE_RUNNING);
+    CHECK(autotune_update(&at, 0.0f, t0_us + 100001) == 0.0f);
+    CHECK(at.state == AUTOTUNE_FAILED);
+    CHECK(!autotune_gains(&at, AUTOTUNE_RULE_ZN, &kp, &ki, &kd));
+
+    test_position();
+    HOST_TEST_END();
+}
@@ -0,0 +1,145 @@
+/*
+ * test_pid_bank.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "pid_control.h"
+
+#define AXES    3
+
+static void configure(struct pid2_param *pp, uint8_t i)
+{
+    pid2_param_init(pp);
+    pp->kp = 0.5f + i;
+    pp->ki = 0.2f * i;
+    pp->kd = 0.05f;
+    pp->b = 0.5f;
+    pp->out_max = 3.0f;
+    pp->i_max = 2.0f;
+}
+
+/* every axis of the bank gives the same output as a pid2 with
+ * the same gains, saturated or not. */
+static void test_equal(void)
+{
+    struct pid_bank bank;
+    struct pid2 ref[AXES];
+    struct pid2_param pp;
+    float sp[PID_BANK_MAX] = {0.0f}, y[PID_BANK_MAX] = {0.0f}, ff[PID_BANK_MAX] = {0.0f};
+    float u;
+
+    srand(1);
+    pid_bank_init(&bank, AXES);
+    for (uint8_t i = 0; i < AXES; i++) {
+        configure(&pp, i);
+        pid_bank_configure(&bank, i, &pp);
+        pid2_configure(&ref[i], &pp);
+        pid2_reset(&ref[i]);
+    }
+
+    for (int n = 0; n < 1000; n++) {
+        for (uint8_t i = 0; i < AXES; i++) {
+            sp[i] = (float)(rand() % 200 - 100) * 0.05f;
+            y[i] = (float)(rand() % 200 - 100) * 0.05f;
+            ff[i] = (float)(rand() % 20 - 10) * 0.01f;
+        }
+        pid_bank_update(&bank, sp, y, (n & 1) ? ff : NULL);
+        for (uint8_t i = 0; i < AXES; i++) {
+            u = pid2_update(&ref[i], sp[i], y[i], (n & 1) ? ff[i] : 0.0f);
+            CHECK_NEAR(bank.out[i], u, 1e-5);
+            CHECK_NEAR(bank.integrator[i], ref[i].integrator, 1e-5);
+        }
+
+        /* a reset axis starts again without a kick. */
+        if (n == 500) {
+            pid_bank_reset(&bank, 1);
+            pid2_reset(&ref[1]);
+        }
+    }
+}
+
+/* ----------------------------------------------------------
+ *
+ * host cost of one control cycle of num axes: the bank, num
+ * pid2_update() & num legacy pid_update() calls, on the same
+ * random inputs.
+ *
+ * --------------------------------------------------------*/
+#define BENCH_N     4096
+#define BENCH_RUNS  100
+
+static void bench_throughput(uint8_t num)
+{
+    static float sp[BENCH_N][PID_BANK_MAX], y[BENCH_N][PID_BANK_MAX];
+    struct pid_bank bank;
+    struct pid2 c[PID_BANK_MAX];
+    struct pid2_param pp;
+    struct pid_param lp[PID_BANK_MAX];
+    struct pid_cfg lc[PID_BANK_MAX];
+    float sink = 0.0f;
+    uint64_t t0, t1, t2, t3;
+
+    for (int n = 0; n < BENCH_N; n++) {
+        for (uint8_t i = 0; i < PID_BANK_MAX; i++) {
+            sp[n][i] = (float)(rand() % 200 - 100) * 0.05f;
+            y[n][i] = (float)(rand() % 200 - 100) * 0.05f;
+        }
+    }
+    pid_bank_init(&bank, num);
+    for (uint8_t i = 0; i < num; i++) {
+        configure(&pp, i);
+        pid_bank_configure(&bank, i, &pp);
+        pid2_configure(&c[i], &pp);
+        pid2_reset(&c[i]);
+        pid_init(&lp[i], &lc[i]);
+        lp[i].kp = pp.kp;
+        lp[i].ki = pp.ki;
+        lp[i].kd = pp.kd;
+        lp[i].out_max = pp.out_max;
+        lp[i].i_max = pp.i_max;
+        lc[i].error_min = 0.0f;
+    }
+
+    t0 = host_ns();
+    for (int k = 0; k < BENCH_RUNS; k++) {
+        for (int n = 0; n < BENCH_N; n++) {
+            pid_bank_update(&bank, sp[n], y[n], NULL);
+            sink += bank.out[0];
+        }
+    }
+    t1 = host_ns();
+    for (int k = 0; k < BENCH_RUNS; k++) {
+        for (int n = 0; n < BENCH_N; n++) {
+            for (uint8_t i = 0; i < num; i++)
+                sink += pid2_update(&c[i], sp[n][i], y[n][i], 0.0f);
+        }
+    }
+    t2 = host_ns();
+    for (int k = 0; k < BENCH_RUNS; k++) {
+        for (int n = 0; n < BENCH_N; n++) {
+            for (uint8_t i = 0; i < num; i++) {
+                lc[i].error = sp[n][i] - y[n][i];
+                pid_update(&lp[i], &lc[i]);
+                sink += lc[i].pid_out;
+            }
+        }
+    }
+    t3 = host_ns();
+
+    printf("pid %u axes: bank %.1f ns/cycle, %ux pid2_update %.1f ns, %ux pid_update %.1f ns\n",
+           num, (double)(t1 - t0) / (BENCH_RUNS * BENCH_N),
+           num, (double)(t2 - t1) / (BENCH_RUNS * BENCH_N),
+           num, (double)(t3 - t2) / (BENCH_RUNS * BENCH_N));
+    CHECK(sink == sink);
+}
+
+int main(void)
+{
+    test_equal();
+    bench_throughput(3);
+    bench_throughput(PID_BANK_MAX);
+    HOST_TEST_END();
+}
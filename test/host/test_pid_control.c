@@ -0,0 +1,313 @@
+/*
+ * test_pid_control.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "pid_control.h"
+
+/* the error based pid_update() keeps its original results. */
+static void test_legacy(void)
+{
+    struct pid_param pp;
+    struct pid_cfg pc;
+
+    pid_init(&pp, &pc);
+    pp.kp = 2.0f;
+    pp.ki = 1.0f;
+    pp.kd = 0.0f;
+    pp.dt = 0.1f;
+    pc.error_min = 0.5f;
+
+    pc.error = 3.0f;
+    pid_update(&pp, &pc);
+    CHECK_NEAR(pc.proportion, 6.0f, 1e-6);
+    CHECK_NEAR(pc.integrator, 0.3f, 1e-6);
+    CHECK_NEAR(pc.pid_out, 6.3f, 1e-5);
+
+    /* without kd last_error is not tracked, no reset on the sign change. */
+    pc.error = -1.0f;
+    pid_update(&pp, &pc);
+    CHECK_NEAR(pc.integrator, 0.2f, 1e-6);
+    CHECK_NEAR(pc.pid_out, -1.8f, 1e-5);
+
+    /* inside the deadband the integrator is cleared & the output held. */
+    pc.error = 0.2f;
+    pid_update(&pp, &pc);
+    CHECK_NEAR(pc.integrator, 0.0f, 1e-6);
+    CHECK_NEAR(pc.pid_out, -1.8f, 1e-5);
+
+    /* with kd the sign change clears the integrator of the same step. */
+    pid_init(&pp, &pc);
+    pp.kp = 2.0f;
+    pp.ki = 1.0f;
+    pp.kd = 0.1f;
+    pp.dt = 0.1f;
+    pp.d_lpf_alpha = 0.0f;
+    pc.error_min = 0.5f;
+    pc.error = 3.0f;
+    pid_update(&pp, &pc);
+    CHECK_NEAR(pc.derivative, 3.0f, 1e-5);
+    CHECK_NEAR(pc.pid_out, 9.3f, 1e-5);
+    pc.error = -1.0f;
+    pid_update(&pp, &pc);
+    CHECK_NEAR(pc.integrator, 0.0f, 1e-6);
+    CHECK_NEAR(pc.derivative, -4.0f, 1e-5);
+    CHECK_NEAR(pc.pid_out, -6.0f, 1e-5);
+}
+
+/* the body of pid_update() before it ran on pid2. */
+static void legacy_update(struct pid_param *pp, struct pid_cfg *pc)
+{
+    if (pc->error < pc->error_min && pc->error > -(pc->error_min)) {
+        pc->integrator = 0;
+        return;
+    }
+    pc->proportion = pp->kp * pc->error;
+
+    // calculate integrator constrain in i_max.
+    if((pp->ki != 0) && (pp->dt != 0)) {
+        pc->integrator += pp->ki * pc->error * pp->dt;
+        if (pc->integrator < -(pp->i_max)) {
+            pc->integrator = -(pp->i_max);
+        } else if (pc->integrator > pp->i_max) {
+            pc->integrator = pp->i_max;
+        }
+    } else {
+        pc->integrator = 0;
+    }
+    if (pc->error * pc->last_error < 0) pc->integrator = 0;
+
+    // calculate instantaneous derivative.
+    if((pp->kd != 0) && (pp->dt != 0)) {
+        pc->derivative = pp->kd * (pc->error - pc->last_error) / pp->dt;
+        // discrete low pass filter, cuts out the
+        // high frequency noise that can drive the controller crazy.
+        pc->derivative = pc->last_derivative + pp->dt / (pp->d_lpf_alpha + pp->dt) * (pc->derivative - pc->last_derivative);
+        // update state
+        pc->last_error = pc->error;
+        pc->last_derivative = pc->derivative;
+    }
+
+    pc->pid_out = pc->proportion + pc->integrator + pc->derivative;
+    if (pc->pid_out > pp->out_max) {
+        pc->pid_out = pp->out_max;
+    } else if (pc->pid_out < -(pp->out_max)) {
+        pc->pid_out = -(pp->out_max);
+    }
+}
+
+/* pid_update() on pid2 gives the old results, kd on & off, in &
+ * out of the deadband, saturated or not. */
+static void test_legacy_equal(void)
+{
+    struct pid_param pp;
+    struct pid_cfg a, b;
+
+    srand(11);
+    pid_init(&pp, &a);
+    pid_init(&pp, &b);
+    pp.kp = 1.5f;
+    pp.ki = 2.0f;
+    pp.dt = 0.02f;
+    pp.i_max = 20.0f;
+    pp.out_max = 40.0f;
+    a.error_min = b.error_min = 1.0f;
+    for (int i = 0; i < 5000; i++) {
+        pp.kd = ((i / 500) & 1) ? 0.0f : 0.2f;
+        a.error = b.error = 60.0f * (float)rand() / (float)RAND_MAX - 30.0f;
+        pid_update(&pp, &a);
+        legacy_update(&pp, &b);
+        CHECK_NEAR(a.pid_out, b.pid_out, 1e-3);
+        CHECK_NEAR(a.integrator, b.integrator, 1e-5);
+        CHECK_NEAR(a.derivative, b.derivative, 1e-3);
+        CHECK_NEAR(a.last_error, b.last_error, 0);
+    }
+}
+
+/* a setpoint step moves only the proportional & integral terms. */
+static void test_no_kick(void)
+{
+    struct pid2_param pp;
+    struct pid2 c;
+    float u0, u1;
+
+    pid2_param_init(&pp);
+    pp.kp = 1.0f;
+    pp.ki = 0.0f;
+    pp.kd = 0.5f;
+    pp.dt = 0.02f;
+    pid2_configure(&c, &pp);
+    pid2_reset(&c);
+
+    u0 = pid2_update(&c, 0.0f, 1.0f, 0.0f);
+    u1 = pid2_update(&c, 10.0f, 1.0f, 0.0f);
+    CHECK_NEAR(u0, -1.0f, 1e-6);
+    CHECK_NEAR(u1, 9.0f, 1e-6);
+    CHECK_NEAR(c.derivative, 0.0f, 1e-6);
+}
+
+/* saturated for a long time, the integrator does not wind up. */
+static void test_anti_windup(void)
+{
+    struct pid2_param pp;
+    struct pid2 c;
+    float u = 0.0f;
+
+    pid2_param_init(&pp);
+    pp.kp = 1.0f;
+    pp.ki = 2.0f;
+    pp.kd = 0.0f;
+    pp.dt = 0.02f;
+    pp.out_max = 5.0f;
+    pp.i_max = 50.0f;
+    pid2_configure(&c, &pp);
+    pid2_reset(&c);
+
+    /* the back-calculation holds the integrator at out_max, far
+     * below i_max. */
+    for (int i = 0; i < 500; i++) u = pid2_update(&c, 100.0f, 0.0f, 0.0f);
+    CHECK_NEAR(u, 5.0f, 1e-6);
+    CHECK_NEAR(c.integrator, 5.0f, 1e-3);
+
+    /* the output leaves the limit as soon as the error turns. */
+    u = pid2_update(&c, -1.0f, 0.0f, 0.0f);
+    CHECK(u < 5.0f);
+}
+
+/* a first order plant y' = (u - y) / tau settles on the setpoint. */
+static void test_closed_loop(void)
+{
+    struct pid2_param pp;
+    struct pid2 c;
+    float y = 0.0f, u;
+
+    pid2_param_init(&pp);
+    pp.kp = 2.0f;
+    pp.ki = 1.0f;
+    pp.kd = 0.05f;
+    pp.dt = 0.02f;
+    pid2_configure(&c, &pp);
+    pid2_reset(&c);
+
+    for (int i = 0; i < 1500; i++) {
+        u = pid2_update(&c, 1.0f, y, 0.0f);
+        y += (u - y) / 0.5f * pp.dt;
+    }
+    CHECK_NEAR(y, 1.0f, 1e-3);
+}
+
+/* ----------------------------------------------------------
+ *
+ * a setpoint step of 1 on y'' = (u - y') / tau, the position
+ * of a copter on its attitude, with the output limited. reports
+ * the overshoot, the 2% settle time & the host cost of an update
+ * for pid_update() & pid2 with the same gains. the cost is timed
+ * on the recorded measurements, without the plant.
+ *
+ * --------------------------------------------------------*/
+#define STEP_N      1000        /* 20s at 50Hz. */
+#define STEP_TAU    0.3f
+#define STEP_RUNS   200
+
+static void step_gains(struct pid_param *pp, struct pid_cfg *pc)
+{
+    pid_init(pp, pc);
+    pp->kp = 2.0f;
+    pp->ki = 0.5f;
+    pp->kd = 0.6f;
+    pp->dt = 0.02f;
+    pp->d_lpf_alpha = 0.02f;
+    pp->i_max = 1.0f;
+    pp->out_max = 1.0f;
+    pc->error_min = 0.0f;
+}
+
+/* returns the settle time, units: s, -1 if it never settles. */
+static float step_report(const char *name, const float *y, double ns)
+{
+    float peak = 0.0f, settle;
+    int last_out = -1;
+
+    for (int i = 0; i < STEP_N; i++) {
+        if (y[i] > peak) peak = y[i];
+        if (fabsf(y[i] - 1.0f) > 0.02f) last_out = i;
+    }
+    settle = (last_out < STEP_N - 1) ? (last_out + 1) * 0.02f : -1.0f;
+    printf("%s step: overshoot %.1f%%, settles in %.2f s, %.1f ns/update\n",
+           name, (peak > 1.0f) ? 100.0f * (peak - 1.0f) : 0.0f, settle, ns);
+    return settle;
+}
+
+static void bench_step(void)
+{
+    static float y1[STEP_N], y2[STEP_N];
+    struct pid_param pp;
+    struct pid_cfg pc;
+    struct pid2_param p2;
+    struct pid2 c;
+    float y, v, u, sink = 0.0f;
+    uint64_t t0, t1, t2;
+
+    step_gains(&pp, &pc);
+    pid2_param_init(&p2);
+    p2.kp = pp.kp;
+    p2.ki = pp.ki;
+    p2.kd = pp.kd;
+    p2.dt = pp.dt;
+    p2.d_lpf_alpha = pp.d_lpf_alpha;
+    p2.i_max = pp.i_max;
+    p2.out_max = pp.out_max;
+    pid2_configure(&c, &p2);
+    pid2_reset(&c);
+
+    y = v = 0.0f;
+    for (int i = 0; i < STEP_N; i++) {
+        pc.error = 1.0f - y;
+        pid_update(&pp, &pc);
+        v += (pc.pid_out - v) / STEP_TAU * pp.dt;
+        y += v * pp.dt;
+        y1[i] = y;
+    }
+    y = v = 0.0f;
+    for (int i = 0; i < STEP_N; i++) {
+        u = pid2_update(&c, 1.0f, y, 0.0f);
+        v += (u - v) / STEP_TAU * p2.dt;
+        y += v * p2.dt;
+        y2[i] = y;
+    }
+
+    t0 = host_ns();
+    for (int k = 0; k < STEP_RUNS; k++) {
+        step_gains(&pp, &pc);
+        for (int i = 0; i < STEP_N; i++) {
+            pc.error = 1.0f - y1[i];
+            pid_update(&pp, &pc);
+            sink += pc.pid_out;
+        }
+    }
+    t1 = host_ns();
+    for (int k = 0; k < STEP_RUNS; k++) {
+        pid2_reset(&c);
+        for (int i = 0; i < STEP_N; i++)
+            sink += pid2_update(&c, 1.0f, y2[i], 0.0f);
+    }
+    t2 = host_ns();
+
+    CHECK(step_report("pid_update", y1, (double)(t1 - t0) / (STEP_RUNS * STEP_N)) > 0.0f);
+    CHECK(step_report("pid2", y2, (double)(t2 - t1) / (STEP_RUNS * STEP_N)) > 0.0f);
+    CHECK(sink == sink);
+}
+
+int main(void)
+{
+    test_legacy();
+    test_legacy_equal();
+    test_no_kick();
+    test_anti_windup();
+    test_closed_loop();
+    bench_step();
+    HOST_TEST_END();
+}
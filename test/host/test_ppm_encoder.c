@@ -0,0 +1,624 @@
+/*
+ * test_ppm_encoder.c
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "host_test.h"
+#include "platform.h"
+#include "r_cg_tmr.h"
+#include "ppm_encoder.h"
+#include "timestamp.h"
+
+/* ----------------------------------------------------------
+ *
+ * host harness of the TMR0 PPM output: ppm_encoder.c runs as
+ * it is, U_TMR0_SetCMPA/U_TMR0_SetOUTA go to a virtual TMR0
+ * whose compare matches call TMR0_IntHandler(). the output
+ * edges are cut into frames, runs of equal frames are one
+ * line:
+ *  <first>-<last> t <us> sep <level> ch <8 widths> idle <us> period <us>
+ * times in us. a frame is cut at the idle level, between its
+ * separators(PPM_ENCODER_NEG_CH_VAL) are the channel widths,
+ * sep is the level of the separators. TMR0 sets the pin to
+ * the level of an edge at the end of its interval, so the
+ * separators come out high and the idle low. the trace of a
+ * scenario is compared with golden/ppm_<scenario>.txt, or
+ * printed without a golden file:
+ *  ./test_ppm_encoder <scenario> [golden]
+ * the ISR time per edge on the host goes to stderr.
+ *
+ * --------------------------------------------------------*/
+#define CNT_PER_US      PPM_CNT_PER_US
+#define IDLE_MIN_US     3000    /* a level this long ends a frame. */
+#define OUT_MAX         (64 * 1024)
+
+/* the virtual TMR0, time in its counts. */
+static uint64_t tmr_t = 0;         /* of the last compare match. */
+static uint64_t tmr_now = 0;       /* may be past it, before the next. */
+static uint16_t tmr_cmp = 0;
+static bool tmr_next = false;
+static bool tmr_running = false;
+static bool pin = true;
+static uint64_t edge_t = 0;
+
+struct host_cmt_unit CMT0, CMT2;
+struct host_cmt CMT;
+struct host_system SYSTEM;
+volatile uint8_t host_icu_dummy;
+
+/* the frame being cut & the last line. */
+struct frame {
+    uint32_t t_us;
+    bool     sep;
+    uint32_t ch[PPM_ENCODER_CHANNEL_NUM];
+    uint32_t idle;
+    uint32_t period;
+};
+static struct frame cur, run;
+static int cur_n = 0;               /* levels of cur so far. */
+static bool cur_ok = false;         /* cur started after an idle level. */
+static uint32_t frames = 0, run_first = 0;
+static uint32_t bad_low = 0, bad_width = 0;
+static char out[OUT_MAX];
+static size_t out_len = 0;
+
+/* failsafe watch: the first channel at its failsafe width
+ * after the trigger, every channel of the flight frame differs. */
+static bool fs_watch = false;
+static uint32_t fs_trigger_us, fs_out_us;
+static uint16_t fs_width[PPM_ENCODER_CHANNEL_NUM];
+
+/* ISR time on the host. */
+static uint64_t isr_ns_sum = 0, isr_ns_max = 0, isr_num = 0;
+
+extern void TMR0_IntHandler(void);
+
+void R_TMR0_Start(void)
+{
+    tmr_running = true;
+}
+
+void U_TMR0_SetCMPA(uint16_t compare_a_value)
+{
+    tmr_cmp = compare_a_value;
+}
+
+void U_TMR0_SetOUTA(bool is_high)
+{
+    tmr_next = is_high;
+}
+
+void xchg(signed long *a, signed long *b)
+{
+    signed long t = *a;
+
+    *a = *b;
+    *b = t;
+}
+
+/* CMT0 also counts 5MHz, CMCOR is one 10ms tick. */
+uint32_t timestamp_us(void)
+{
+    return (uint32_t)(tmr_now / CNT_PER_US);
+}
+
+static void out_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#include <stdarg.h>
+static void out_printf(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    out_len += (size_t)vsnprintf(out + out_len, OUT_MAX - out_len, fmt, ap);
+    va_end(ap);
+    if (out_len >= OUT_MAX) out_len = OUT_MAX - 1;
+}
+
+static void run_flush(void)
+{
+    if (frames == run_first) return;
+    out_printf("%u-%u t %u sep %d ch", (unsigned)run_first, (unsigned)(frames - 1), (unsigned)run.t_us,
+               (int)run.sep);
+    for (int i = 0; i < PPM_ENCODER_CHANNEL_NUM; i++) out_printf(" %u", (unsigned)run.ch[i]);
+    out_printf(" idle %u period %u\n", (unsigned)run.idle, (unsigned)run.period);
+    run_first = frames;
+}
+
+static bool frame_same(const struct frame *a, const struct frame *b)
+{
+    return a->sep == b->sep && !memcmp(a->ch, b->ch, sizeof(a->ch)) && a->idle == b->idle
+           && a->period == b->period;
+}
+
+/* a level of us ended at the edge, the separators are even in the frame. */
+static void level_end(bool level, uint32_t us, uint32_t t_us)
+{
+    if (us >= IDLE_MIN_US) {
+        if (cur_ok && cur_n == PPM_EDGE_NUM - 1) {
+            cur.idle = us;
+            cur.period += us;
+            if (frames == run_first || !frame_same(&cur, &run)) {
+                run_flush();
+                run = cur;
+            }
+            frames++;
+        }
+        cur_ok = true;
+        cur_n = 0;
+        cur.sep = !level;
+        cur.period = 0;
+        cur.t_us = t_us;
+        return;
+    }
+    if (!cur_ok) return;
+    if (cur_n >= PPM_EDGE_NUM - 1 || level != (cur.sep ^ (bool)(cur_n & 1))) {
+        cur_ok = false;
+        return;
+    }
+    if (!(cur_n & 1)) {
+        if (us != PPM_ENCODER_NEG_CH_VAL) bad_low++;
+    } else {
+        cur.ch[cur_n / 2] = us;
+        if (fs_watch && us == fs_width[cur_n / 2] && t_us - us >= fs_trigger_us) {
+            fs_out_us = t_us - us;
+            fs_watch = false;
+        }
+        if (us < channel_val_MIN || us > channel_val_MAX) bad_width++;
+    }
+    cur.period += us;
+    cur_n++;
+}
+
+/* one compare match: the output takes the level set up, then the ISR runs. */
+static void tmr_match(void)
+{
+    struct timespec a, b;
+    uint64_t ns;
+
+    tmr_t += tmr_cmp;
+    tmr_now = tmr_t;
+    CMT0.CMCNT = (uint16_t)((tmr_t / CNT_PER_US * TIMESTAMP_CNT_PER_US) % (CMT0.CMCOR + 1UL));
+    if (tmr_next != pin) {
+        level_end(pin, (uint32_t)((tmr_t - edge_t) / CNT_PER_US), (uint32_t)(tmr_t / CNT_PER_US));
+        pin = tmr_next;
+        edge_t = tmr_t;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    TMR0_IntHandler();
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    ns = (uint64_t)(b.tv_sec - a.tv_sec) * 1000000000u + (uint64_t)b.tv_nsec - (uint64_t)a.tv_nsec;
+    isr_ns_sum += ns;
+    if (ns > isr_ns_max) isr_ns_max = ns;
+    isr_num++;
+}
+
+static void run_to(uint32_t t_ms)
+{
+    while (tmr_running && tmr_t < (uint64_t)t_ms * 1000 * CNT_PER_US) tmr_match();
+}
+
+/* runs the matches up to t_us, & stops the time there, between two of them. */
+static void run_to_us(uint64_t t_us)
+{
+    while (tmr_running && tmr_t + tmr_cmp <= t_us * CNT_PER_US) tmr_match();
+    tmr_now = t_us * CNT_PER_US;
+    CMT0.CMCNT = (uint16_t)((tmr_now / CNT_PER_US * TIMESTAMP_CNT_PER_US) % (CMT0.CMCOR + 1UL));
+}
+
+/*-----------------------------------------------------------*/
+/* the command sequences of the missions. */
+
+/* mission.c mission_throttle(). */
+static void base_throttle(uint16_t throttle)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[THROTTLE_CHANNEL] = throttle;
+    ch[MODE_CHANNEL] = Alt_Hold;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(THROTTLE_CHANNEL) | PPM_CH(MODE_CHANNEL), ch);
+}
+
+/* mission.c arm() & the start of the climb. */
+static void scenario_arm_climb(void)
+{
+    run_to(100);
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MAX, Alt_Hold, EMERGENCY_OFF);
+    run_to(3100);
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    run_to(3105);
+    base_throttle(channel_percent(20));
+    run_to(3605);
+    base_throttle(channel_percent(50));
+    run_to(4105);
+    base_throttle(channel_percent(60));
+    run_to(4400);
+}
+
+/* the position & altitude loops own their channels over the base. */
+static void scenario_pos_hold(void)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    send_ppm(channel_val_MID, channel_val_MID, channel_percent(60), channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    run_to(100);
+    ppm_channel_claim(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL));
+    ppm_channel_claim(PPM_OWNER_POS, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL));
+    for (int i = 0; i < 10; i++) {
+        ch[ROLL_CHANNEL] = (uint16_t)(channel_val_MID + 10 * i);
+        ch[PITCH_CHANNEL] = (uint16_t)(channel_val_MID - 7 * i);
+        ch[THROTTLE_CHANNEL] = (uint16_t)(channel_percent(60) + 3 * i);
+        ppm_channel_update(PPM_OWNER_POS, PPM_CH_ALL, ch);
+        ppm_channel_update(PPM_OWNER_ALT, PPM_CH_ALL, ch);
+        run_to(100 + 20 * (i + 1) + 7);
+    }
+    /* the base writes under them, nothing moves until released. */
+    ch[ROLL_CHANNEL] = ch[PITCH_CHANNEL] = ch[THROTTLE_CHANNEL] = channel_val_MIN;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL) | PPM_CH(THROTTLE_CHANNEL), ch);
+    run_to(400);
+    ppm_channel_release(PPM_OWNER_POS, PPM_CH_ALL);
+    ppm_channel_release(PPM_OWNER_ALT, PPM_CH_ALL);
+    run_to(500);
+}
+
+/* ----------------------------------------------------------
+ *
+ * triggers the failsafe at phases 0.7ms apart over a frame,
+ * the frames differ in every channel. reports the time from
+ * the trigger to the start edge of the first channel at its
+ * failsafe width on the pin, next to the trigger to switch
+ * time the ISR measures itself. the frame is only switched at
+ * a channel start & the level the ISR sets up comes out at
+ * the match after, so the pin lags the switch by a channel.
+ * a trigger in the idle waits for the rest of it.
+ *
+ * --------------------------------------------------------*/
+#define FS_PHASES       28
+
+static void failsafe_sweep(void)
+{
+    const uint16_t fs_ch[PPM_ENCODER_CHANNEL_NUM] =
+            {1300, 1300, channel_val_MIN, 1300, Stabilize, 700, 700, EMERGENCY_ON};
+    uint32_t t_ms = 400, phase, lat, lat_min = UINT32_MAX, lat_max = 0, lat_sum = 0, isr_max = 0;
+
+    ppm_failsafe_preload(fs_ch);
+    memcpy(fs_width, fs_ch, sizeof(fs_width));
+    send_ppm(channel_val_MID, channel_val_MID, channel_percent(60), channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    for (int i = 0; i < FS_PHASES; i++) {
+        t_ms += 60;
+        run_to(t_ms);
+        run_to_us((uint64_t)cur.t_us + 20000 + 700 * (uint32_t)i);
+        fs_trigger_us = timestamp_us();
+        phase = fs_trigger_us - cur.t_us;
+        fs_watch = true;
+        ppm_failsafe_trigger();
+        t_ms += 60;
+        run_to(t_ms);
+        CHECK(!fs_watch);
+        lat = fs_out_us - fs_trigger_us;
+        fprintf(stderr, "failsafe at %5u us in the frame: output %5u us, ISR switch %4u us\n",
+                (unsigned)phase, (unsigned)lat, (unsigned)ppm_failsafe_latency_us());
+        if (lat < lat_min) lat_min = lat;
+        if (lat > lat_max) lat_max = lat;
+        if (ppm_failsafe_latency_us() > isr_max) isr_max = ppm_failsafe_latency_us();
+        lat_sum += lat;
+        ppm_failsafe_clear();
+    }
+    fprintf(stderr, "failsafe trigger to output over %d phases: min %u avg %u max %u us, "
+            "ISR switch max %u us\n", FS_PHASES, (unsigned)lat_min, (unsigned)(lat_sum / FS_PHASES),
+            (unsigned)lat_max, (unsigned)isr_max);
+    /* at most the longest channel & the one after in a frame, the idle & a separator after it. */
+    CHECK(lat_max <= PPM_ENCODER_TOTAL_CH_VAL);
+}
+
+/* danger_check.c preloads the emergency frame, a trigger mid frame. */
+static void scenario_failsafe(void)
+{
+    /* EMERGENCY_CHANNELS of mission.h */
+    const uint16_t emergency_ch[PPM_ENCODER_CHANNEL_NUM] =
+            {channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MID,
+             Stabilize, channel_val_MIN, channel_val_MIN, EMERGENCY_ON};
+
+    ppm_failsafe_preload(emergency_ch);
+    send_ppm(channel_val_MID, channel_val_MID, channel_percent(60), channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    run_to(206);
+    ppm_failsafe_trigger();
+    run_to(300);
+    CHECK(ppm_failsafe_active());
+    CHECK(ppm_failsafe_latency_us() > 0 && ppm_failsafe_latency_us() <= channel_val_MAX + PPM_ENCODER_NEG_CH_VAL);
+    ppm_failsafe_clear();
+    run_to(400);
+    failsafe_sweep();
+}
+
+/* mission.c is_sonar_lost_now(): only the mode goes to Land. */
+static void scenario_sonar_lost(void)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    send_ppm(channel_val_MID, channel_val_MID, channel_percent(60), channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    run_to(150);
+    ch[MODE_CHANNEL] = Land;
+    ppm_channel_claim(PPM_OWNER_FAILSAFE, PPM_CH(MODE_CHANNEL));
+    ppm_channel_update(PPM_OWNER_FAILSAFE, PPM_CH(MODE_CHANNEL), ch);
+    base_throttle(channel_percent(40));
+    run_to(300);
+}
+
+/* ----------------------------------------------------------
+ *
+ * the channel writes of mission.c missions 1 to 6 in order,
+ * with their delays. the altitude & position loops are stood
+ * in for by fixed outputs per phase, which the owners merge
+ * like the real ones, & the events the missions wait for come
+ * at fixed times. no mission aborts.
+ *
+ * --------------------------------------------------------*/
+#define M_CLIMB         (channel_percent(60) + 40)
+#define M_HOVER         (channel_percent(60) + 10)
+#define M_DESCEND       (channel_percent(60) - 30)
+
+static uint32_t m_t;                /* mission time, units: ms */
+
+static void m_wait(uint32_t ms)
+{
+    m_t += ms;
+    run_to(m_t);
+}
+
+/* mission.c mission_pitch(). */
+static void base_pitch(uint16_t pitch)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[ROLL_CHANNEL] = channel_val_MID;
+    ch[PITCH_CHANNEL] = pitch;
+    ch[MODE_CHANNEL] = Alt_Hold;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL) | PPM_CH(MODE_CHANNEL), ch);
+}
+
+/* arm(Alt_Hold) & the throttle ramp before the loops start. */
+static void m_arm_ramp(uint32_t d20, uint32_t d50, uint32_t d55, uint32_t d60)
+{
+    m_t = 100;
+    run_to(m_t);
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MAX, Alt_Hold, EMERGENCY_OFF);
+    m_wait(3000);
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MID, Alt_Hold, EMERGENCY_OFF);
+    base_throttle(channel_percent(20));
+    m_wait(d20);
+    base_throttle(channel_percent(50));
+    m_wait(d50);
+    base_throttle(channel_percent(55));
+    m_wait(d55);
+    base_throttle(channel_percent(60));
+    m_wait(d60);
+}
+
+static void m_disarm(void)
+{
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MIN, Stabilize, EMERGENCY_ON);
+    m_wait(5000);
+    send_ppm(channel_val_MID, channel_val_MID, channel_val_MIN, channel_val_MID, Stabilize, EMERGENCY_OFF);
+    m_wait(500);
+}
+
+/* the position loop output on roll & pitch. */
+static void m_pos(uint16_t roll, uint16_t pitch)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[ROLL_CHANNEL] = roll;
+    ch[PITCH_CHANNEL] = pitch;
+    ppm_channel_update(PPM_OWNER_POS, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL), ch);
+}
+
+/* the altitude loop output on the throttle. */
+static void m_alt(uint16_t throttle)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ch[THROTTLE_CHANNEL] = throttle;
+    ppm_channel_update(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL), ch);
+}
+
+/* position_ctl_start() & climb_to(), the position is held level. */
+static void m_start_climb(void)
+{
+    ppm_channel_claim(PPM_OWNER_POS, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL));
+    m_pos(channel_val_MID, channel_val_MID);
+    ppm_channel_claim(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL));
+    m_alt(M_CLIMB);
+    m_wait(2000);
+    m_alt(M_HOVER);
+}
+
+static void m_descend(uint32_t ms)
+{
+    m_alt(M_DESCEND);
+    m_wait(ms);
+    m_alt(M_HOVER);
+}
+
+/* position_ctl_stop(). */
+static void m_pos_stop(void)
+{
+    uint16_t ch[PPM_ENCODER_CHANNEL_NUM] = {0};
+
+    ppm_channel_release(PPM_OWNER_POS, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL));
+    ch[ROLL_CHANNEL] = ch[PITCH_CHANNEL] = channel_val_MID;
+    ppm_channel_update(PPM_OWNER_BASE, PPM_CH(ROLL_CHANNEL) | PPM_CH(PITCH_CHANNEL), ch);
+}
+
+/* alt_ctl_stop(). */
+static void m_alt_stop(void)
+{
+    ppm_channel_release(PPM_OWNER_ALT, PPM_CH(THROTTLE_CHANNEL));
+}
+
+/* hold the height & the line. */
+static void scenario_mission_1(void)
+{
+    m_arm_ramp(500, 500, 500, 500);
+    m_start_climb();
+    m_pos(channel_val_MID + 12, channel_val_MID - 9);
+    m_wait(15000);
+    m_descend(2000);
+    m_alt_stop();
+    m_pos_stop();
+    m_disarm();
+}
+
+/* only switches the camera mode. */
+static void scenario_mission_2(void)
+{
+    m_t = 0;
+    m_wait(2000);
+}
+
+/* follow the car for 15s, then go backward & land. */
+static void scenario_mission_3(void)
+{
+    m_arm_ramp(100, 100, 200, 100);
+    m_start_climb();
+    m_pos(channel_val_MID, channel_val_MID + 30);
+    m_wait(15000);
+    m_pos_stop();
+    base_pitch(channel_val_MID - 18);
+    m_descend(1000);
+    base_pitch(channel_val_MID);
+    m_descend(1000);
+    m_alt_stop();
+    m_disarm();
+}
+
+/* follow the car until it stops, then go forward & land. */
+static void scenario_mission_4(void)
+{
+    m_arm_ramp(100, 100, 200, 100);
+    m_start_climb();
+    m_pos(channel_val_MID - 6, channel_val_MID + 30);
+    m_wait(8000);               /* NOTIFY_CAR_STOP */
+    m_pos_stop();
+    base_pitch(channel_val_MID + 18);
+    m_descend(1000);
+    base_pitch(channel_val_MID);
+    m_descend(1000);
+    m_alt_stop();
+    m_disarm();
+}
+
+/* started by the car, moves left on its command, lands when told. */
+static void scenario_mission_5(void)
+{
+    m_t = 0;
+    m_wait(1000);               /* NOTIFY_MISSION_5 */
+    m_arm_ramp(500, 500, 500, 500);
+    m_start_climb();
+    m_wait(5000);               /* NOTIFY_M5_LEFT */
+    m_pos(channel_val_MID - 25, channel_val_MID);
+    m_wait(2000);
+    m_pos(channel_val_MID, channel_val_MID);
+    m_wait(3000);               /* NOTIFY_M5_STOP */
+    m_descend(3000);
+    m_alt_stop();
+    m_pos_stop();
+    m_disarm();
+}
+
+/* the relay test on the roll axis, 4 cycles of 1.7s. */
+static void scenario_mission_6(void)
+{
+    m_arm_ramp(500, 500, 500, 500);
+    m_start_climb();
+    m_wait(3000);
+    for (int i = 0; i < 8; i++) {
+        m_pos((uint16_t)(channel_val_MID + ((i & 1) ? -10 : 10)), channel_val_MID);
+        m_wait(840);
+    }
+    m_pos(channel_val_MID, channel_val_MID);
+    m_descend(2000);
+    m_alt_stop();
+    m_pos_stop();
+    m_disarm();
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} scenarios[] = {
+    {"arm_climb",  scenario_arm_climb},
+    {"pos_hold",   scenario_pos_hold},
+    {"failsafe",   scenario_failsafe},
+    {"sonar_lost", scenario_sonar_lost},
+    {"mission_1",  scenario_mission_1},
+    {"mission_2",  scenario_mission_2},
+    {"mission_3",  scenario_mission_3},
+    {"mission_4",  scenario_mission_4},
+    {"mission_5",  scenario_mission_5},
+    {"mission_6",  scenario_mission_6},
+};
+
+/* compares out with the golden file, reports the first line that differs. */
+static void golden_check(const char *path)
+{
+    static char gold[OUT_MAX];
+    FILE *f = fopen(path, "r");
+    size_t n, line = 1;
+
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    n = fread(gold, 1, OUT_MAX - 1, f);
+    fclose(f);
+    gold[n] = '\0';
+    for (size_t i = 0; i < n || i < out_len; i++) {
+        if (i >= n || i >= out_len || gold[i] != out[i]) {
+            printf("%s:%u: trace differs from the golden file\n", path, (unsigned)line);
+            host_test_failed++;
+            return;
+        }
+        if (gold[i] == '\n') line++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int s;
+
+    if (argc < 2) {
+        printf("usage: %s <scenario> [golden]\n", argv[0]);
+        return 2;
+    }
+    for (s = 0; s < (int)(sizeof(scenarios) / sizeof(scenarios[0])); s++) {
+        if (!strcmp(argv[1], scenarios[s].name)) break;
+    }
+    if (s == (int)(sizeof(scenarios) / sizeof(scenarios[0]))) {
+        printf("unknown scenario %s\n", argv[1]);
+        return 2;
+    }
+
+    CMT0.CMCOR = (uint16_t)(TIMESTAMP_CNT_PER_TICK - 1);
+    ppm_encoder_init();
+    scenarios[s].run();
+    run_flush();
+
+    CHECK(frames > 0);
+    CHECK(bad_low == 0);
+    CHECK(bad_width == 0);
+    fprintf(stderr, "%s: %u edges, ISR on the host %.0f ns average, %u ns max\n", argv[1],
+            (unsigned)isr_num, isr_num ? (double)isr_ns_sum / (double)isr_num : 0.0, (unsigned)isr_ns_max);
+
+    if (argc < 3) {
+        fputs(out, stdout);
+        return host_test_failed ? 1 : 0;
+    }
+    golden_check(argv[2]);
+    HOST_TEST_END();
+}
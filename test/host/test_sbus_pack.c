@@ -0,0 +1,69 @@
+/*
+ * test_sbus_pack.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "sbus_encoder.h"
+
+/* the receiver side, bit by bit so it shares nothing with the packer. */
+static void sbus_unpack(const uint8_t *frame, uint16_t *val)
+{
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) {
+        val[i] = 0;
+        for (int b = 0; b < 11; b++) {
+            int bit = i * 11 + b;
+            if (frame[1 + bit / 8] & (1 << (bit % 8))) val[i] |= (uint16_t)(1 << b);
+        }
+    }
+}
+
+static void round_trip(const uint16_t *val, uint8_t flags)
+{
+    uint8_t frame[SBUS_FRAME_LEN];
+    uint16_t out[SBUS_CHANNEL_NUM];
+
+    sbus_pack(val, flags, frame);
+    CHECK(frame[0] == SBUS_HEADER);
+    CHECK(frame[SBUS_FRAME_LEN - 2] == flags);
+    CHECK(frame[SBUS_FRAME_LEN - 1] == SBUS_FOOTER);
+    sbus_unpack(frame, out);
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) CHECK(out[i] == (val[i] & SBUS_VAL_MAX));
+}
+
+int main(void)
+{
+    uint16_t val[SBUS_CHANNEL_NUM];
+    uint8_t frame[SBUS_FRAME_LEN];
+
+    /* all zero, all ones & one channel at a time. */
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) val[i] = 0;
+    round_trip(val, 0);
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) val[i] = SBUS_VAL_MAX;
+    round_trip(val, SBUS_FLAG_FAILSAFE | SBUS_FLAG_FRAME_LOST);
+    sbus_pack(val, 0, frame);
+    for (int i = 1; i < SBUS_FRAME_LEN - 2; i++) CHECK(frame[i] == 0xFF);
+    for (int c = 0; c < SBUS_CHANNEL_NUM; c++) {
+        for (int i = 0; i < SBUS_CHANNEL_NUM; i++) val[i] = (i == c) ? SBUS_VAL_MAX : 0;
+        round_trip(val, 0);
+    }
+
+    /* values above 11 bits are cut, the neighbours are untouched. */
+    for (int i = 0; i < SBUS_CHANNEL_NUM; i++) val[i] = 0xFFFF;
+    round_trip(val, 0);
+
+    srand(1);
+    for (int n = 0; n < 1000; n++) {
+        for (int i = 0; i < SBUS_CHANNEL_NUM; i++) val[i] = (uint16_t)(rand() & SBUS_VAL_MAX);
+        round_trip(val, (uint8_t)(rand() & 0x0F));
+    }
+
+    /* the receiver mapping of the PPM widths. */
+    CHECK(SBUS_US_TO_VAL(880) == 0);
+    CHECK(SBUS_CH_IDLE == 992);
+    CHECK(SBUS_US_TO_VAL(2000) == 1792);
+
+    HOST_TEST_END();
+}
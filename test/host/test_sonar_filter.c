@@ -0,0 +1,248 @@
+/*
+ * test_sonar_filter.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "sonar_filter.h"
+
+#define PERIOD_US   50000       /* the echo period of the module. */
+
+static uint16_t cnt(float h)
+{
+    return (uint16_t)(h / SONAR_M_PER_CNT + 0.5f);
+}
+
+static bool valid(sonar_filter_e ret)
+{
+    return ret == SONAR_FILTER_VALID || ret == SONAR_FILTER_LIMITED;
+}
+
+/* feeds n echoes of height h, returns the last result. */
+static sonar_filter_e steady(struct sonar_filter *sf, uint32_t *t, float h, int n, float *out)
+{
+    sonar_filter_e ret = SONAR_FILTER_FILL;
+
+    for (int i = 0; i < n; i++, *t += PERIOD_US)
+        ret = sonar_filter_echo(sf, cnt(h), *t, out);
+    return ret;
+}
+
+static void test_fill(void)
+{
+    struct sonar_filter sf;
+    uint32_t t = 0;
+    float h;
+
+    sonar_filter_init(&sf);
+    for (int i = 0; i < SONAR_MEDIAN_N - 1; i++, t += PERIOD_US) {
+        CHECK(sonar_filter_echo(&sf, cnt(1.0f + 0.01f * i), t, &h) == SONAR_FILTER_FILL);
+        CHECK_NEAR(h, 1.0f + 0.01f * i, 1e-3);
+    }
+    CHECK(sonar_filter_echo(&sf, cnt(1.04f), t, &h) == SONAR_FILTER_VALID);
+    CHECK_NEAR(h, 1.02f, 1e-3);
+}
+
+/* a spike or two in the window are outvoted by the median. */
+static void test_spike(void)
+{
+    struct sonar_filter sf;
+    uint32_t t = 0;
+    float h;
+
+    sonar_filter_init(&sf);
+    CHECK(steady(&sf, &t, 1.0f, 10, &h) == SONAR_FILTER_VALID);
+    CHECK(sonar_filter_echo(&sf, cnt(3.5f), t, &h) == SONAR_FILTER_VALID);
+    CHECK_NEAR(h, 1.0f, 1e-3);
+    t += PERIOD_US;
+    CHECK(sonar_filter_echo(&sf, cnt(0.1f), t, &h) == SONAR_FILTER_VALID);
+    CHECK_NEAR(h, 1.0f, 1e-3);
+    t += PERIOD_US;
+    CHECK(steady(&sf, &t, 1.0f, 1, &h) == SONAR_FILTER_VALID);
+    CHECK_NEAR(h, 1.0f, 1e-3);
+}
+
+/* a step is taken at SONAR_RATE_MAX once the median follows it. */
+static void test_rate(void)
+{
+    struct sonar_filter sf;
+    uint32_t t = 0;
+    float h, last;
+    int limited = 0;
+
+    sonar_filter_init(&sf);
+    steady(&sf, &t, 1.0f, 10, &last);
+    for (int i = 0; i < 20; i++, t += PERIOD_US) {
+        sonar_filter_e ret = sonar_filter_echo(&sf, cnt(2.0f), t, &h);
+        CHECK(valid(ret));
+        CHECK(h - last <= SONAR_RATE_MAX * PERIOD_US * 1e-6f + 1e-4f);
+        if (ret == SONAR_FILTER_LIMITED) limited++;
+        last = h;
+    }
+    CHECK(limited > 0);
+    CHECK_NEAR(h, 2.0f, 1e-3);
+}
+
+/* up to N/2 misses keep the window, one more starts it afresh. */
+static void test_dropout(void)
+{
+    struct sonar_filter sf;
+    uint32_t t = 0;
+    float h;
+
+    sonar_filter_init(&sf);
+    steady(&sf, &t, 1.0f, 10, &h);
+    for (int i = 0; i < SONAR_MEDIAN_N / 2; i++, t += PERIOD_US) {
+        CHECK(sonar_filter_echo(&sf, cnt(SONAR_H_MAX + 1.0f), t, &h) == SONAR_FILTER_RANGE);
+        CHECK_NEAR(h, 1.0f, 1e-3);
+    }
+    CHECK(steady(&sf, &t, 1.0f, 1, &h) == SONAR_FILTER_VALID);
+
+    for (int i = 0; i <= SONAR_MEDIAN_N / 2; i++, t += PERIOD_US)
+        CHECK(sonar_filter_echo(&sf, 0, t, &h) == SONAR_FILTER_RANGE);
+    CHECK(steady(&sf, &t, 1.5f, SONAR_MEDIAN_N - 1, &h) == SONAR_FILTER_FILL);
+    /* no rate limit after a restart. */
+    CHECK(steady(&sf, &t, 1.5f, 1, &h) == SONAR_FILTER_VALID);
+    CHECK_NEAR(h, 1.5f, 1e-3);
+}
+
+/* lost echoes count as misses too, a long run must not wrap. */
+static void test_timeout(void)
+{
+    struct sonar_filter sf;
+    uint32_t t = 0;
+    float h;
+
+    sonar_filter_init(&sf);
+    steady(&sf, &t, 0.8f, 10, &h);
+    CHECK_NEAR(sonar_filter_miss(&sf), 0.8f, 1e-3);
+    CHECK_NEAR(sonar_filter_miss(&sf), 0.8f, 1e-3);
+    CHECK(steady(&sf, &t, 0.8f, 1, &h) == SONAR_FILTER_VALID);
+
+    for (int i = 0; i < 300; i++) sonar_filter_miss(&sf);
+    CHECK(steady(&sf, &t, 0.8f, 1, &h) == SONAR_FILTER_FILL);
+}
+
+/* roughly normal, sigma 1. */
+static float noise(void)
+{
+    float s = 0.0f;
+
+    for (int i = 0; i < 12; i++) s += (float)rand() / (float)RAND_MAX;
+    return s - 6.0f;
+}
+
+/* ----------------------------------------------------------
+ *
+ * replays an echo trace of a climb from 0.3m to 2m & back at
+ * 0.5m/s with 1cm noise, spike_pct % spikes anywhere in the
+ * range, range_pct % echoes out of range & lost_pct % lost
+ * ones, and reports the error of the valid output against
+ * the true height & the cost per echo. the median delays the
+ * output by about N/2 periods, the rms error is mostly that
+ * lag. three spikes in one window outvote the median, the
+ * rate limit bounds how far they pull the output.
+ *
+ * --------------------------------------------------------*/
+#define ECHOES      20000
+#define LOST        0xFFFF      /* the capture timed out. */
+
+struct replay_result {
+    int   valid;
+    int   off;                  /* valid outputs more than 0.2m off. */
+    float rms;                  /* units: m */
+    float max;
+};
+
+static void replay(const char *name, int spike_pct, int range_pct, int lost_pct,
+                   struct replay_result *res)
+{
+    struct sonar_filter sf;
+    static uint16_t trace[ECHOES];
+    static float truth[ECHOES];
+    uint32_t t = 0;
+    uint64_t t0, t1;
+    float h, err, sum2 = 0.0f, v = 0.5f, x = 0.3f;
+    int lost = 0;
+
+    srand(17);
+    for (int i = 0; i < ECHOES; i++) {
+        x += v * PERIOD_US * 1e-6f;
+        if (x > 2.0f) v = -0.5f;
+        if (x < 0.3f) v = 0.5f;
+        truth[i] = x;
+        int r = rand() % 100;
+        if (r < spike_pct)
+            trace[i] = cnt(SONAR_H_MIN + (SONAR_H_MAX - SONAR_H_MIN) * rand() / RAND_MAX);
+        else if ((r -= spike_pct) < range_pct)
+            trace[i] = (r & 1) ? 0 : cnt(SONAR_H_MAX + 0.5f);
+        else if ((r -= range_pct) < lost_pct)
+            trace[i] = LOST;
+        else
+            trace[i] = cnt(x + 0.01f * noise());
+    }
+
+    res->valid = res->off = 0;
+    res->max = 0.0f;
+    sonar_filter_init(&sf);
+    for (int i = 0; i < ECHOES; i++, t += PERIOD_US) {
+        if (trace[i] == LOST) {
+            sonar_filter_miss(&sf);
+            lost++;
+            continue;
+        }
+        if (!valid(sonar_filter_echo(&sf, trace[i], t, &h))) continue;
+        err = fabsf(h - truth[i]);
+        sum2 += err * err;
+        if (err > res->max) res->max = err;
+        if (err > 0.2f) res->off++;
+        res->valid++;
+    }
+    res->rms = sqrtf(sum2 / res->valid);
+
+    sonar_filter_init(&sf);
+    t0 = host_ns();
+    for (int k = 0; k < 50; k++) {
+        for (int i = 0; i < ECHOES; i++, t += PERIOD_US) {
+            if (trace[i] == LOST) sonar_filter_miss(&sf);
+            else sonar_filter_echo(&sf, trace[i], t, &h);
+        }
+    }
+    t1 = host_ns();
+    printf("sonar replay %s: %d echoes, %d lost, %d valid out, rms %.1f mm, max %.1f mm, "
+           "%d over 0.2m, %.1f ns/echo\n",
+           name, ECHOES, lost, res->valid, 1000.0 * res->rms, 1000.0 * res->max, res->off,
+           (double)(t1 - t0) / (50.0 * ECHOES));
+}
+
+static void test_replay(void)
+{
+    struct replay_result res;
+
+    replay("clean", 0, 0, 0, &res);
+    CHECK(res.valid == ECHOES - SONAR_MEDIAN_N + 1);
+    CHECK(res.rms < 0.06f);
+    CHECK(res.max < 0.1f);
+
+    replay("spikes", 5, 0, 0, &res);
+    CHECK(res.rms < 0.07f);
+    CHECK(res.off < ECHOES / 200);
+
+    replay("spikes+dropouts+timeouts", 5, 5, 3, &res);
+    CHECK(res.valid > ECHOES * 3 / 4);
+    CHECK(res.rms < 0.08f);
+    CHECK(res.off < ECHOES / 200);
+}
+
+int main(void)
+{
+    test_fill();
+    test_spike();
+    test_rate();
+    test_dropout();
+    test_timeout();
+    test_replay();
+    HOST_TEST_END();
+}
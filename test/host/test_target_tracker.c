@@ -0,0 +1,167 @@
+/*
+ * test_target_tracker.c
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "host_test.h"
+#include "target_tracker.h"
+
+#define W   160.0f
+#define H   120.0f
+
+/* a target moving at 40 pixel/s from a start time, frames 33ms apart. */
+static void run_ramp(uint32_t t0_us)
+{
+    struct target_tracker tr;
+    uint32_t t_us = t0_us;
+    float x, y, mx = 20.0f;
+
+    tracker_init(&tr, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, W, H);
+    CHECK(!tracker_predict(&tr, t_us, &x, &y));
+    for (int i = 0; i < 60; i++) {
+        tracker_update(&tr, mx, 60.0f, t_us);
+        mx += 40.0f * 0.033f;
+        t_us += 33000;
+    }
+    CHECK_NEAR(tr.vx, 40.0f, 0.5f);
+    CHECK_NEAR(tr.vy, 0.0f, 0.01f);
+
+    /* 33ms on, where the next frame would be. */
+    CHECK(tracker_predict(&tr, t_us, &x, &y));
+    CHECK_NEAR(x, mx, 0.2f);
+    CHECK_NEAR(y, 60.0f, 0.01f);
+}
+
+static void test_limits(void)
+{
+    struct target_tracker tr;
+    float x, y;
+
+    tracker_init(&tr, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, W, H);
+    tracker_update(&tr, 150.0f, 10.0f, 1000000);
+    tracker_update(&tr, 155.0f, 5.0f, 1010000);
+    CHECK(tr.vx > 0.0f && tr.vy < 0.0f);
+
+    /* extrapolation stops at TRACKER_MAX_PREDICT_MS & inside the image. */
+    CHECK(tracker_predict(&tr, 1010000 + 10000000, &x, &y));
+    CHECK(x <= W - 1.0f && y >= 0.0f);
+    /* an older time is not extrapolated backwards. */
+    CHECK(tracker_predict(&tr, 1000000, &x, &y));
+    CHECK_NEAR(x, tr.x, 1e-3);
+
+    /* inside the image, past the cap is the same as at the cap,
+     * which is further than just before it. */
+    {
+        struct target_tracker mid;
+        uint32_t t_cap = 1010000 + TRACKER_MAX_PREDICT_MS * 1000UL;
+        float xc, yc, xb, yb;
+
+        tracker_init(&mid, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, W, H);
+        tracker_update(&mid, 80.0f, 60.0f, 1000000);
+        tracker_update(&mid, 81.0f, 59.5f, 1010000);
+        CHECK(tracker_predict(&mid, t_cap, &xc, &yc));
+        CHECK(xc > 0.0f && xc < W - 1.0f && yc > 0.0f && yc < H - 1.0f);
+        CHECK(tracker_predict(&mid, t_cap + 10000000, &x, &y));
+        CHECK_NEAR(x, xc, 1e-6);
+        CHECK_NEAR(y, yc, 1e-6);
+        CHECK(tracker_predict(&mid, t_cap - 10000, &xb, &yb));
+        CHECK(xb < xc && yb > yc);
+    }
+
+    /* a gap longer than TRACKER_MAX_DT_MS restarts at the measurement. */
+    tracker_update(&tr, 80.0f, 40.0f, 1010000 + (TRACKER_MAX_DT_MS + 1) * 1000UL);
+    CHECK_NEAR(tr.x, 80.0f, 1e-6);
+    CHECK_NEAR(tr.vx, 0.0f, 1e-6);
+}
+
+/* roughly normal, sigma 1. */
+static float noise(void)
+{
+    float s = 0.0f;
+
+    for (int i = 0; i < 12; i++) s += (float)rand() / (float)RAND_MAX;
+    return s - 6.0f;
+}
+
+static float truth_x(uint32_t t_us)
+{
+    return 80.0f + 50.0f * sinf(6.2831853f * (float)t_us * 1e-6f / 4.0f);
+}
+
+static float truth_y(uint32_t t_us)
+{
+    return 60.0f + 30.0f * sinf(6.2831853f * (float)t_us * 1e-6f / 3.0f + 1.0f);
+}
+
+/* ----------------------------------------------------------
+ *
+ * replays a target weaving across the image, captured every
+ * 33ms with 1 pixel of noise & received POS_CAM_LATENCY_MS
+ * later, as the position loop sees it at 50Hz. reports the
+ * rms error against the true position at the loop time for
+ * the last raw sample, the tracker estimate at its frame time,
+ * and the tracker prediction to the loop time, and the host
+ * cost of an update & a prediction.
+ *
+ * --------------------------------------------------------*/
+#define REPLAY_S        120
+#define FRAME_US        33000
+#define LATENCY_US      40000   /* POS_CAM_LATENCY_MS */
+#define LOOP_US         20000
+
+static void bench_prediction(void)
+{
+    struct target_tracker tr;
+    uint32_t t_frame = 0, t_loop = LATENCY_US;
+    float raw_x = 0.0f, raw_y = 0.0f, x, y, ex, ey;
+    float sum_raw = 0.0f, sum_filt = 0.0f, sum_pred = 0.0f;
+    int n = 0;
+    uint64_t t0, t1;
+
+    srand(4);
+    tracker_init(&tr, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, W, H);
+    for (; t_loop < REPLAY_S * 1000000UL; t_loop += LOOP_US) {
+        /* the frames received by now. */
+        while (t_frame + LATENCY_US <= t_loop) {
+            raw_x = truth_x(t_frame) + noise();
+            raw_y = truth_y(t_frame) + noise();
+            tracker_update(&tr, raw_x, raw_y, t_frame);
+            t_frame += FRAME_US;
+        }
+        ex = raw_x - truth_x(t_loop);
+        ey = raw_y - truth_y(t_loop);
+        sum_raw += ex * ex + ey * ey;
+        ex = tr.x - truth_x(t_loop);
+        ey = tr.y - truth_y(t_loop);
+        sum_filt += ex * ex + ey * ey;
+        tracker_predict(&tr, t_loop, &x, &y);
+        ex = x - truth_x(t_loop);
+        ey = y - truth_y(t_loop);
+        sum_pred += ex * ex + ey * ey;
+        n++;
+    }
+
+    t0 = host_ns();
+    for (int i = 0; i < 1000000; i++) {
+        tracker_update(&tr, 80.0f + (float)(i & 15), 60.0f, (uint32_t)i * FRAME_US);
+        tracker_predict(&tr, (uint32_t)i * FRAME_US + LATENCY_US, &x, &y);
+    }
+    t1 = host_ns();
+
+    printf("tracking error over %d loops: raw %.2f px, filtered %.2f px, predicted %.2f px rms, "
+           "%.1f ns per update & prediction\n",
+           n, sqrt(sum_raw / n), sqrt(sum_filt / n), sqrt(sum_pred / n), (double)(t1 - t0) / 1e6);
+    CHECK(sum_pred < sum_raw);
+    CHECK(x == x);
+}
+
+int main(void)
+{
+    run_ramp(1000000);
+    /* across the wrap of timestamp_us(). */
+    run_ramp(0xFFFFFFFFUL - 1000000);
+    test_limits();
+    bench_prediction();
+    HOST_TEST_END();
+}
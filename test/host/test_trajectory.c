@@ -0,0 +1,176 @@
+/*
+ * test_trajectory.c
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "host_test.h"
+#include "trajectory.h"
+#include "pid_control.h"
+
+#define DT  0.02f
+
+/* the ALT_* values, alt_control.h needs the RTOS. */
+#define ALT_TRAJ_V_MAX  0.3f
+#define ALT_TRAJ_A_MAX  0.3f
+#define ALT_H_KP        1.2f
+#define ALT_RATE_MAX    0.5f
+#define ALT_RATE_KP     120.0f
+#define ALT_RATE_KI     60.0f
+#define ALT_RATE_I_MAX  80.0f
+#define ALT_THR_MAX     150.0f
+#define ALT_DONE_BAND   0.05f
+
+/* steps until done, checks the speed & acceleration limits on
+ * the way, returns the steps. */
+static int run(struct trajectory *tr, int max_steps)
+{
+    float last_vel = tr->vel;
+    int n;
+
+    for (n = 0; n < max_steps && !tr->done; n++) {
+        trajectory_step(tr, DT);
+        CHECK(fabsf(tr->vel) <= tr->v_max + 1e-5f);
+        /* the last step snaps onto the target, from at most 2 * a_max * DT. */
+        CHECK(fabsf(tr->vel - last_vel) <= (tr->done ? 2.0f : 1.0f) * tr->a_max * DT + 1e-5f);
+        last_vel = tr->vel;
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------
+ *
+ * a 1m climb & the descent back, the loop of alt_ctl_task: one
+ * trajectory step & the height & climb rate pid2 per sonar
+ * sample, 20Hz. the throttle around hover accelerates the
+ * copter at THR_ACC, with drag. reports the move times, the
+ * worst distance from the profile & the host cost of a cycle,
+ * and its share of the host at the sample rate.
+ *
+ * --------------------------------------------------------*/
+#define ALT_DT      0.05f
+#define THR_ACC     0.02f       /* units: m/s^2 per ppm us */
+#define DRAG        1.0f        /* units: 1/s */
+#define CLIMB_RUNS  2000
+
+struct alt_loop {
+    struct trajectory tr;
+    struct pid2 h_pid;
+    struct pid2 rate_pid;
+    float h;
+    float v;
+};
+
+static void alt_loop_init(struct alt_loop *a)
+{
+    struct pid2_param pp;
+
+    pid2_param_init(&pp);
+    pp.kp = ALT_H_KP;
+    pp.ki = 0.0f;
+    pp.kd = 0.0f;
+    pp.dt = ALT_DT;
+    pp.i_max = ALT_RATE_MAX;
+    pp.out_max = ALT_RATE_MAX;
+    pid2_configure(&a->h_pid, &pp);
+    pid2_reset(&a->h_pid);
+    pp.kp = ALT_RATE_KP;
+    pp.ki = ALT_RATE_KI;
+    pp.i_max = ALT_RATE_I_MAX;
+    pp.out_max = ALT_THR_MAX;
+    pid2_configure(&a->rate_pid, &pp);
+    pid2_reset(&a->rate_pid);
+    a->h = 0.2f;
+    a->v = 0.0f;
+    trajectory_init(&a->tr, a->h, ALT_TRAJ_V_MAX, ALT_TRAJ_A_MAX);
+}
+
+/* one control cycle, returns the throttle around hover. */
+static float alt_loop_cycle(struct alt_loop *a)
+{
+    float rate_dest;
+
+    trajectory_step(&a->tr, ALT_DT);
+    rate_dest = pid2_update(&a->h_pid, a->tr.pos, a->h, a->tr.vel);
+    return pid2_update(&a->rate_pid, rate_dest, a->v, 0.0f);
+}
+
+/* moves to target, returns the cycles until done & in band. */
+static int alt_move(struct alt_loop *a, float target, float *track_max)
+{
+    float u;
+    int n;
+
+    trajectory_set_target(&a->tr, target);
+    for (n = 1; n < 2000; n++) {
+        u = alt_loop_cycle(a);
+        a->v += (THR_ACC * u - DRAG * a->v) * ALT_DT;
+        a->h += a->v * ALT_DT;
+        if (fabsf(a->h - a->tr.pos) > *track_max) *track_max = fabsf(a->h - a->tr.pos);
+        if (a->tr.done && fabsf(a->h - target) < ALT_DONE_BAND) break;
+    }
+    return n;
+}
+
+static void bench_climb(void)
+{
+    struct alt_loop a;
+    float track = 0.0f, sink = 0.0f;
+    int up, down;
+    uint64_t t0, t1;
+
+    alt_loop_init(&a);
+    up = alt_move(&a, 1.2f, &track);
+    down = alt_move(&a, 0.2f, &track);
+
+    t0 = host_ns();
+    for (int k = 0; k < CLIMB_RUNS; k++) {
+        alt_loop_init(&a);
+        trajectory_set_target(&a.tr, (k & 1) ? 0.2f : 1.2f);
+        for (int n = 0; n < up; n++) sink += alt_loop_cycle(&a);
+    }
+    t1 = host_ns();
+
+    double ns = (double)(t1 - t0) / ((double)CLIMB_RUNS * up);
+    printf("altitude climb 1m in %.2f s, descent in %.2f s, %.1f cm off the profile at most, "
+           "%.1f ns/cycle, %.5f%% of the host at %.0f Hz\n",
+           up * ALT_DT, down * ALT_DT, 100.0f * track, ns, ns * 1e-9 / ALT_DT * 100.0, 1.0 / ALT_DT);
+    CHECK(up * ALT_DT < 6.0f);
+    CHECK(down * ALT_DT < 6.0f);
+    CHECK(track < 0.1f);
+    CHECK(sink == sink);
+}
+
+int main(void)
+{
+    struct trajectory tr;
+    int n;
+
+    /* 1m up at 0.5m/s & 1m/s^2: 0.5s up to speed, 1.5s cruise, 0.5s brake. */
+    trajectory_init(&tr, 0.2f, 0.5f, 1.0f);
+    CHECK(tr.done);
+    trajectory_set_target(&tr, 1.2f);
+    n = run(&tr, 1000);
+    CHECK(tr.done);
+    CHECK_NEAR(tr.pos, 1.2f, 1e-6);
+    CHECK_NEAR(tr.vel, 0.0f, 1e-6);
+    CHECK_NEAR(n * DT, 2.5f, 0.1f);
+
+    /* too short to reach v_max, a triangle. */
+    trajectory_set_target(&tr, 1.0f);
+    n = run(&tr, 1000);
+    CHECK_NEAR(tr.pos, 1.0f, 1e-6);
+    CHECK_NEAR(n * DT, 2.0f * sqrtf(0.2f / 1.0f), 0.1f);
+
+    /* a new target behind while climbing turns around smoothly. */
+    trajectory_set_target(&tr, 2.0f);
+    for (int i = 0; i < 40; i++) trajectory_step(&tr, DT);
+    CHECK(tr.vel > 0.0f);
+    trajectory_set_target(&tr, 0.5f);
+    run(&tr, 1000);
+    CHECK(tr.done);
+    CHECK_NEAR(tr.pos, 0.5f, 1e-6);
+
+    bench_climb();
+    HOST_TEST_END();
+}